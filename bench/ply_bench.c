@@ -0,0 +1,274 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "main.h"
+#include "ply_loader.h"
+#include "ply_synth.h"
+
+/* Maximal number of repetitions of one measurement */
+#define BENCH_MAX_REPEAT	100
+
+/* Number of phases of loading measured separately */
+#define BENCH_PHASES		4
+
+static const char *phase_names[BENCH_PHASES] = {
+	"header", "alloc", "vertices", "faces"
+};
+
+static int compare_double(const void *a, const void *b)
+{
+	double d1 = *(const double*)a, d2 = *(const double*)b;
+
+	return (d1 < d2) ? -1 : ((d1 > d2) ? 1 : 0);
+}
+
+/**
+ * @brief This function loads PLY file repeatedly and stores median
+ * duration of each phase of loading
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int bench_load(const char *filename, int repeat, double *medians)
+{
+	double samples[BENCH_PHASES][BENCH_MAX_REPEAT];
+	int r, k;
+
+	for(r = 0; r < repeat; r++) {
+		struct PLYLoadTimes times;
+		struct CTX ctx;
+		int ret;
+
+		init_CTX(&ctx);
+		ret = load_ply_file(&ctx, filename, &times);
+		clear_CTX(&ctx);
+		if(ret != 1) {
+			printf("ERROR: Unable to load PLY file: %s\n", filename);
+			return 0;
+		}
+
+		samples[0][r] = times.header;
+		samples[1][r] = times.alloc;
+		samples[2][r] = times.vertices;
+		samples[3][r] = times.faces;
+	}
+
+	for(k = 0; k < BENCH_PHASES; k++) {
+		qsort(samples[k], repeat, sizeof(double), compare_double);
+		medians[k] = samples[k][repeat / 2];
+	}
+
+	return 1;
+}
+
+static void print_help(char *prog_name)
+{
+	printf("\n Usage: %s [options]\n", prog_name);
+	printf("\n");
+	printf(" This program generates PLY files of growing size and measures\n");
+	printf(" parsing of header, allocation, decoding of vertices and decoding\n");
+	printf(" of faces. Results are written in JSON format.\n");
+	printf("\n");
+	printf(" Options:\n");
+	printf(" -s vertices       Number of vertices of the smallest file\n");
+	printf("                   (default: 1000).\n");
+	printf(" -S vertices       Number of vertices of the biggest file; size is\n");
+	printf("                   multiplied by 10 (default: 1000000).\n");
+	printf(" -r ratio          Number of faces per vertex (default: 2).\n");
+	printf(" -a arity          Number of vertices of faces or range of them\n");
+	printf("                   (default: 3).\n");
+	printf(" -p props          Comma separated list of extra vertex properties\n");
+	printf("                   (default: none).\n");
+	printf(" -F formats        Comma separated list of formats (ascii, le, be)\n");
+	printf("                   (default: ascii,le,be).\n");
+	printf(" -D                Store coordinates as double.\n");
+	printf(" -n repeat         Number of loads of each file (default: 3).\n");
+	printf(" -T directory      Directory of generated files (default: .).\n");
+	printf(" -k                Keep generated files.\n");
+	printf(" -o filename       JSON file with results (default: ply_bench.json).\n");
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct PLYSynthParams params;
+	const char *formats = "ascii,le,be", *props = "none", *dir = ".";
+	const char *output = "ply_bench.json";
+	uint64_t min_size = 1000, max_size = 1000000, size;
+	double ratio = 2.0;
+	int opt, repeat = 3, keep = 0, first = 1;
+	FILE *json;
+
+	params.min_arity = params.max_arity = 3;
+	params.double_coords = 0;
+
+	while( (opt = getopt(argc, argv, "hs:S:r:a:p:F:Dn:T:ko:")) != -1) {
+		switch(opt) {
+		case 'h':
+			print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+		case 's':
+			min_size = strtoull(optarg, NULL, 10);
+			break;
+		case 'S':
+			max_size = strtoull(optarg, NULL, 10);
+			break;
+		case 'r':
+			ratio = atof(optarg);
+			break;
+		case 'a':
+			if(ply_synth_parse_arity(optarg, &params) != 1) {
+				printf("ERROR: Wrong arity of faces: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'p':
+			props = optarg;
+			break;
+		case 'F':
+			formats = optarg;
+			break;
+		case 'D':
+			params.double_coords = 1;
+			break;
+		case 'n':
+			repeat = atoi(optarg);
+			break;
+		case 'T':
+			dir = optarg;
+			break;
+		case 'k':
+			keep = 1;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	params.props = ply_synth_parse_props(props);
+	if(params.props == -1) {
+		printf("ERROR: Unknown vertex property: %s\n", props);
+		exit(EXIT_FAILURE);
+	}
+
+	if(optind != argc || min_size < 1 || max_size < min_size || ratio < 0.0 ||
+			repeat < 1 || repeat > BENCH_MAX_REPEAT) {
+		print_help(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	json = fopen(output, "w");
+	if(json == NULL) {
+		printf("ERROR: Unable to open file: %s\n", output);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(json, "{\n  \"benchmark\": \"ply_loader\",\n");
+	fprintf(json, "  \"coordinates\": \"%s\",\n", sizeof(mesh_real) == 8 ? "double" : "float");
+	fprintf(json, "  \"repeat\": %d,\n  \"results\": [", repeat);
+
+	for(size = min_size; size <= max_size; size *= 10) {
+		const char *format_str = formats;
+
+		while(*format_str != '\0') {
+			char format_name[32], filename[1024];
+			double medians[BENCH_PHASES], total = 0.0;
+			size_t len = strcspn(format_str, ",");
+			struct stat st;
+			int k;
+
+			snprintf(format_name, sizeof(format_name), "%.*s", (int)len, format_str);
+			format_str += len;
+			if(*format_str == ',') format_str++;
+
+			params.format = ply_synth_parse_format(format_name);
+			if(params.format == -1) {
+				printf("ERROR: Unknown format: %s\n", format_name);
+				fclose(json);
+				exit(EXIT_FAILURE);
+			}
+			params.nvertices = size;
+			params.nfaces = (uint64_t)(ratio * size);
+
+			snprintf(filename, sizeof(filename), "%s/ply_bench_%lu_%s.ply",
+					dir, (unsigned long)size, format_name);
+
+			if(ply_synth_write(filename, &params) != 1 ||
+					bench_load(filename, repeat, medians) != 1) {
+				fclose(json);
+				exit(EXIT_FAILURE);
+			}
+			if(stat(filename, &st) != 0) {
+				st.st_size = 0;
+			}
+			if(keep == 0) {
+				unlink(filename);
+			}
+
+			fprintf(json, "%s\n    {\"format\": \"%s\", \"vertices\": %lu, \"faces\": %lu, "
+					"\"arity\": \"%d-%d\", \"props\": \"%s\", \"file_bytes\": %lu",
+					(first == 1) ? "" : ",",
+					ply_synth_format_name(params.format),
+					(unsigned long)params.nvertices, (unsigned long)params.nfaces,
+					params.min_arity, params.max_arity, props,
+					(unsigned long)st.st_size);
+			for(k = 0; k < BENCH_PHASES; k++) {
+				fprintf(json, ", \"%s_s\": %.9f", phase_names[k], medians[k]);
+				total += medians[k];
+			}
+			fprintf(json, ", \"total_s\": %.9f", total);
+			fprintf(json, ", \"vertices_per_s\": %.1f", (medians[2] > 0.0) ?
+					params.nvertices / medians[2] : 0.0);
+			fprintf(json, ", \"faces_per_s\": %.1f", (medians[3] > 0.0) ?
+					params.nfaces / medians[3] : 0.0);
+			fprintf(json, ", \"bytes_per_s\": %.1f}", (total > 0.0) ?
+					st.st_size / total : 0.0);
+			fflush(json);
+			first = 0;
+
+			printf("%s: vertices: %lu, faces: %lu, header: %.6f s, alloc: %.6f s, "
+					"vertices: %.6f s, faces: %.6f s\n",
+					format_name, (unsigned long)params.nvertices,
+					(unsigned long)params.nfaces,
+					medians[0], medians[1], medians[2], medians[3]);
+		}
+
+		/* Avoid overflow of size */
+		if(size > max_size / 10) break;
+	}
+
+	fprintf(json, "\n  ]\n}\n");
+	fclose(json);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ply_synth.h"
+
+static void print_help(char *prog_name)
+{
+	printf("\n Usage: %s [options] filename\n", prog_name);
+	printf("\n");
+	printf(" This program generates synthetic PLY file.\n");
+	printf("\n");
+	printf(" Options:\n");
+	printf(" -v vertices       Number of vertices (default: 1000).\n");
+	printf(" -f faces          Number of faces (default: 2 * vertices).\n");
+	printf(" -a arity          Number of vertices of faces (3 - %d) or range\n",
+			PLY_SYNTH_MAX_ARITY);
+	printf("                   of them (e.g. 3-4) (default: 3).\n");
+	printf(" -p props          Comma separated list of extra vertex properties:\n");
+	printf("                   normal, color, uv, confidence, intensity\n");
+	printf("                   (default: none).\n");
+	printf(" -F format         Format of file: ascii, binary_little_endian (le)\n");
+	printf("                   or binary_big_endian (be) (default: le).\n");
+	printf(" -D                Store coordinates as double.\n");
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct PLYSynthParams params;
+	int opt, faces_set = 0;
+
+	params.format = PLY_SYNTH_BINARY_LE;
+	params.nvertices = 1000;
+	params.nfaces = 0;
+	params.min_arity = params.max_arity = 3;
+	params.props = 0;
+	params.double_coords = 0;
+
+	while( (opt = getopt(argc, argv, "hv:f:a:p:F:D")) != -1) {
+		switch(opt) {
+		case 'h':
+			print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			params.nvertices = strtoull(optarg, NULL, 10);
+			break;
+		case 'f':
+			params.nfaces = strtoull(optarg, NULL, 10);
+			faces_set = 1;
+			break;
+		case 'a':
+			if(ply_synth_parse_arity(optarg, &params) != 1) {
+				printf("ERROR: Wrong arity of faces: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'p':
+			params.props = ply_synth_parse_props(optarg);
+			if(params.props == -1) {
+				printf("ERROR: Unknown vertex property: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'F':
+			params.format = ply_synth_parse_format(optarg);
+			if(params.format == -1) {
+				printf("ERROR: Unknown format: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'D':
+			params.double_coords = 1;
+			break;
+		default:
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if( (optind + 1) != argc) {
+		print_help(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if(faces_set == 0) {
+		params.nfaces = 2 * params.nvertices;
+	}
+
+	if(ply_synth_write(argv[optind], &params) != 1) {
+		exit(EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
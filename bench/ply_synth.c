@@ -0,0 +1,278 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <rply.h>
+
+#include "ply_synth.h"
+
+/**
+ * Names of extra properties in the order of bits of PLYSynthParams.props
+ */
+static const struct {
+	const char *name;
+	int flag;
+} known_props[] = {
+	{"normal", PLY_SYNTH_NORMAL},
+	{"color", PLY_SYNTH_COLOR},
+	{"uv", PLY_SYNTH_UV},
+	{"confidence", PLY_SYNTH_CONFIDENCE},
+	{"intensity", PLY_SYNTH_INTENSITY},
+	{NULL, 0}
+};
+
+static const char *format_names[] = {
+	"ascii",
+	"binary_little_endian",
+	"binary_big_endian"
+};
+
+/**
+ * @brief This function returns format of PLY file (PLY_SYNTH_ASCII, ...)
+ * or -1 for unknown format
+ */
+int ply_synth_parse_format(const char *str)
+{
+	if(strcmp(str, "ascii") == 0) {
+		return PLY_SYNTH_ASCII;
+	} else if(strcmp(str, "le") == 0 || strcmp(str, format_names[1]) == 0) {
+		return PLY_SYNTH_BINARY_LE;
+	} else if(strcmp(str, "be") == 0 || strcmp(str, format_names[2]) == 0) {
+		return PLY_SYNTH_BINARY_BE;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief This function returns name of format used in header of PLY file
+ */
+const char *ply_synth_format_name(int format)
+{
+	return format_names[format];
+}
+
+/**
+ * @brief This function parses comma separated list of extra properties
+ * (e.g. "normal,color"). String "none" means no extra property.
+ *
+ * @return Bit mask of properties or -1 for unknown property
+ */
+int ply_synth_parse_props(const char *str)
+{
+	int props = 0;
+
+	if(strcmp(str, "none") == 0) {
+		return 0;
+	}
+
+	while(*str != '\0') {
+		size_t len = strcspn(str, ",");
+		int i;
+
+		for(i = 0; known_props[i].name != NULL; i++) {
+			if(strlen(known_props[i].name) == len &&
+					strncmp(known_props[i].name, str, len) == 0) {
+				props |= known_props[i].flag;
+				break;
+			}
+		}
+		if(known_props[i].name == NULL) {
+			return -1;
+		}
+
+		str += len;
+		if(*str == ',') str++;
+	}
+
+	return props;
+}
+
+/**
+ * @brief This function parses arity of faces: one number (e.g. "3") or
+ * range (e.g. "3-4")
+ *
+ * @return 1 on success, 0 on failure
+ */
+int ply_synth_parse_arity(const char *str, struct PLYSynthParams *params)
+{
+	char *end;
+
+	params->min_arity = (int)strtol(str, &end, 10);
+	params->max_arity = params->min_arity;
+	if(*end == '-') {
+		params->max_arity = (int)strtol(end + 1, &end, 10);
+	}
+
+	return (*end == '\0' &&
+			params->min_arity >= 3 &&
+			params->max_arity <= PLY_SYNTH_MAX_ARITY &&
+			params->min_arity <= params->max_arity) ? 1 : 0;
+}
+
+/**
+ * @brief This function writes vertex indices of one face. Triangles split
+ * cells of grid to halves, bigger faces use neighbours of corner of cell.
+ * Indices wrap around at the end of array of vertices.
+ */
+static void write_face(p_ply ply, uint64_t face_id, int arity,
+		uint64_t nvertices, uint64_t width)
+{
+	const int64_t w = (int64_t)width;
+	const int64_t offsets[PLY_SYNTH_MAX_ARITY] = {0, 1, w + 1, w, w - 1, -1, -w - 1, -w};
+	const int64_t triangles[2][3] = {{0, 1, w + 1}, {0, w + 1, w}};
+	uint64_t cell;
+	int k;
+
+	ply_write(ply, arity);
+
+	if(arity == 3) {
+		cell = (face_id / 2) % nvertices;
+		for(k = 0; k < 3; k++) {
+			ply_write(ply, (double)((cell + nvertices + triangles[face_id % 2][k]) % nvertices));
+		}
+	} else {
+		cell = face_id % nvertices;
+		for(k = 0; k < arity; k++) {
+			ply_write(ply, (double)((cell + nvertices + offsets[k]) % nvertices));
+		}
+	}
+}
+
+/**
+ * @brief This function generates mesh described by parameters and writes
+ * it to PLY file using libRPLY.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int ply_synth_write(const char *filename, const struct PLYSynthParams *params)
+{
+	static const e_ply_storage_mode modes[] = {
+			PLY_ASCII, PLY_LITTLE_ENDIAN, PLY_BIG_ENDIAN};
+	e_ply_type coord_type = (params->double_coords == 1) ? PLY_DOUBLE : PLY_FLOAT;
+	uint64_t width, i;
+	p_ply ply;
+
+	if(params->nfaces > 0 && params->nvertices == 0) {
+		printf("ERROR: Faces require at least one vertex\n");
+		return 0;
+	}
+
+	ply = ply_create(filename, modes[params->format], NULL, 0, NULL);
+	if(ply == NULL) {
+		printf("ERROR: Unable to create PLY file: %s\n", filename);
+		return 0;
+	}
+
+	ply_add_comment(ply, "synthetic mesh generated by ply_gen");
+
+	ply_add_element(ply, "vertex", (long)params->nvertices);
+	ply_add_scalar_property(ply, "x", coord_type);
+	ply_add_scalar_property(ply, "y", coord_type);
+	ply_add_scalar_property(ply, "z", coord_type);
+	if(params->props & PLY_SYNTH_NORMAL) {
+		ply_add_scalar_property(ply, "nx", PLY_FLOAT);
+		ply_add_scalar_property(ply, "ny", PLY_FLOAT);
+		ply_add_scalar_property(ply, "nz", PLY_FLOAT);
+	}
+	if(params->props & PLY_SYNTH_COLOR) {
+		ply_add_scalar_property(ply, "red", PLY_UCHAR);
+		ply_add_scalar_property(ply, "green", PLY_UCHAR);
+		ply_add_scalar_property(ply, "blue", PLY_UCHAR);
+		ply_add_scalar_property(ply, "alpha", PLY_UCHAR);
+	}
+	if(params->props & PLY_SYNTH_UV) {
+		ply_add_scalar_property(ply, "u", PLY_FLOAT);
+		ply_add_scalar_property(ply, "v", PLY_FLOAT);
+	}
+	if(params->props & PLY_SYNTH_CONFIDENCE) {
+		ply_add_scalar_property(ply, "confidence", PLY_FLOAT);
+	}
+	if(params->props & PLY_SYNTH_INTENSITY) {
+		ply_add_scalar_property(ply, "intensity", PLY_FLOAT);
+	}
+
+	ply_add_element(ply, "face", (long)params->nfaces);
+	ply_add_list_property(ply, "vertex_indices", PLY_UCHAR, PLY_INT);
+
+	if(!ply_write_header(ply)) {
+		printf("ERROR: Unable to write header of PLY file: %s\n", filename);
+		ply_close(ply);
+		return 0;
+	}
+
+	width = (uint64_t)ceil(sqrt((double)params->nvertices));
+	if(width == 0) width = 1;
+
+	for(i = 0; i < params->nvertices; i++) {
+		double u = (double)(i % width) / width;
+		double v = (double)(i / width) / width;
+		double z = 0.1 * sin(2.0*M_PI*u) * cos(2.0*M_PI*v);
+
+		ply_write(ply, u);
+		ply_write(ply, v);
+		ply_write(ply, z);
+		if(params->props & PLY_SYNTH_NORMAL) {
+			double nx = -0.2*M_PI * cos(2.0*M_PI*u) * cos(2.0*M_PI*v);
+			double ny = 0.2*M_PI * sin(2.0*M_PI*u) * sin(2.0*M_PI*v);
+			double len = sqrt(nx*nx + ny*ny + 1.0);
+			ply_write(ply, nx/len);
+			ply_write(ply, ny/len);
+			ply_write(ply, 1.0/len);
+		}
+		if(params->props & PLY_SYNTH_COLOR) {
+			ply_write(ply, (double)(int)(255.0*u));
+			ply_write(ply, (double)(int)(255.0*v));
+			ply_write(ply, (double)(i % 256));
+			ply_write(ply, 255.0);
+		}
+		if(params->props & PLY_SYNTH_UV) {
+			ply_write(ply, u);
+			ply_write(ply, v);
+		}
+		if(params->props & PLY_SYNTH_CONFIDENCE) {
+			ply_write(ply, 0.5 + 0.5*u);
+		}
+		if(params->props & PLY_SYNTH_INTENSITY) {
+			ply_write(ply, 0.5 + 0.5*v);
+		}
+	}
+
+	for(i = 0; i < params->nfaces; i++) {
+		int arity = params->min_arity +
+				(int)(i % (uint64_t)(params->max_arity - params->min_arity + 1));
+		write_face(ply, i, arity, params->nvertices, width);
+	}
+
+	if(!ply_close(ply)) {
+		printf("ERROR: Unable to write PLY file: %s\n", filename);
+		return 0;
+	}
+
+	return 1;
+}
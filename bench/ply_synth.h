@@ -0,0 +1,74 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#ifndef PLY_SYNTH_H_
+#define PLY_SYNTH_H_
+
+/* Maximal number of vertices of one face */
+#define PLY_SYNTH_MAX_ARITY	8
+
+/* Extra properties of vertices */
+#define PLY_SYNTH_NORMAL	1
+#define PLY_SYNTH_COLOR		2
+#define PLY_SYNTH_UV		4
+#define PLY_SYNTH_CONFIDENCE	8
+#define PLY_SYNTH_INTENSITY	16
+
+/* Formats of PLY file */
+#define PLY_SYNTH_ASCII		0
+#define PLY_SYNTH_BINARY_LE	1
+#define PLY_SYNTH_BINARY_BE	2
+
+/**
+ * Parameters of generated mesh. Vertices lie on square grid and faces
+ * are fans around cells of the grid.
+ */
+typedef struct PLYSynthParams {
+	/* One of PLY_SYNTH_ASCII, PLY_SYNTH_BINARY_LE, PLY_SYNTH_BINARY_BE */
+	int format;
+	uint64_t nvertices;
+	uint64_t nfaces;
+	/* Arity of faces cycles from min_arity to max_arity (3 - 8) */
+	int min_arity;
+	int max_arity;
+	/* Bit mask of PLY_SYNTH_NORMAL, PLY_SYNTH_COLOR, ... */
+	int props;
+	/* Store coordinates as double instead of float */
+	int double_coords;
+} PLYSynthParams;
+
+int ply_synth_parse_format(const char *str);
+
+const char *ply_synth_format_name(int format);
+
+int ply_synth_parse_props(const char *str);
+
+int ply_synth_parse_arity(const char *str, struct PLYSynthParams *params);
+
+int ply_synth_write(const char *filename, const struct PLYSynthParams *params);
+
+#endif /* PLY_SYNTH_H_ */
@@ -0,0 +1,318 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+/* Framebuffer objects are core since OpenGL 3.0 */
+#define GL_GLEXT_PROTOTYPES
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "main.h"
+#include "render.h"
+
+/* Default number of measured frames */
+#define BENCH_FRAMES 200
+
+/* Default number of frames drawn before measurement */
+#define BENCH_WARMUP 20
+
+/**
+ * Offscreen OpenGL context without any window
+ */
+typedef struct Offscreen {
+	EGLDisplay display;
+	EGLContext context;
+	GLuint framebuffer;
+	GLuint renderbuffers[2];
+} Offscreen;
+
+static double time_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief This function creates OpenGL context without surface on EGL
+ * display (Mesa surfaceless platform, when it is available) and
+ * framebuffer object used as render target.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int offscreen_init(struct Offscreen *offscreen, int width, int height)
+{
+	EGLint config_attribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE};
+	EGLConfig config = NULL;
+	EGLint major, minor, nconfigs = 0;
+
+	offscreen->display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	offscreen->display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL);
+#endif
+	if(offscreen->display == EGL_NO_DISPLAY) {
+		offscreen->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if(offscreen->display == EGL_NO_DISPLAY ||
+			eglInitialize(offscreen->display, &major, &minor) != EGL_TRUE) {
+		printf("ERROR: Unable to initialize EGL display\n");
+		return 0;
+	}
+
+	if(eglBindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+		printf("ERROR: EGL does not support OpenGL\n");
+		return 0;
+	}
+
+	/* Context is never bound to any surface, so any config works */
+	eglChooseConfig(offscreen->display, config_attribs, &config, 1, &nconfigs);
+	offscreen->context = eglCreateContext(offscreen->display,
+			(nconfigs > 0) ? config : (EGLConfig)0, EGL_NO_CONTEXT, NULL);
+	if(offscreen->context == EGL_NO_CONTEXT ||
+			eglMakeCurrent(offscreen->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+					offscreen->context) != EGL_TRUE) {
+		printf("ERROR: Unable to create OpenGL context without surface\n");
+		return 0;
+	}
+
+	glGenFramebuffers(1, &offscreen->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreen->framebuffer);
+	glGenRenderbuffers(2, offscreen->renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreen->renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_RENDERBUFFER, offscreen->renderbuffers[0]);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreen->renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+			GL_RENDERBUFFER, offscreen->renderbuffers[1]);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		printf("ERROR: Framebuffer object is not complete\n");
+		return 0;
+	}
+
+	printf("renderer: %s, %s (EGL %d.%d)\n",
+			(const char*)glGetString(GL_RENDERER),
+			(const char*)glGetString(GL_VERSION), major, minor);
+
+	return 1;
+}
+
+static void offscreen_free(struct Offscreen *offscreen)
+{
+	if(offscreen->framebuffer != 0) {
+		glDeleteRenderbuffers(2, offscreen->renderbuffers);
+		glDeleteFramebuffers(1, &offscreen->framebuffer);
+	}
+	if(offscreen->display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(offscreen->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if(offscreen->context != EGL_NO_CONTEXT) {
+			eglDestroyContext(offscreen->display, offscreen->context);
+		}
+		eglTerminate(offscreen->display);
+	}
+}
+
+/**
+ * @brief This function moves camera to position of frame on fixed path:
+ * one orbit around mesh with zooming from fitted distance to close-up.
+ */
+static void camera_path(struct Camera *camera, double distance, int frame, int nframes)
+{
+	double t = (double)frame / nframes;
+
+	camera->yaw = -45.0 + 360.0 * t;
+	camera->pitch = -60.0 + 20.0 * sin(2.0 * M_PI * t);
+	camera->distance = distance * (0.65 + 0.35 * cos(2.0 * M_PI * t));
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double d1 = *(const double*)a, d2 = *(const double*)b;
+
+	return (d1 < d2) ? -1 : ((d1 > d2) ? 1 : 0);
+}
+
+static void print_help(char *prog_name)
+{
+	printf("\n Usage: %s [options] filename\n", prog_name);
+	printf("\n");
+	printf(" This program renders PLY model offscreen along fixed camera\n");
+	printf(" path and reports frame times of preview renderer.\n");
+	printf("\n");
+	printf(" Options:\n");
+	printf(" -n frames         Number of measured frames (default: %d).\n", BENCH_FRAMES);
+	printf(" -w frames         Number of frames drawn before measurement\n");
+	printf("                   (default: %d).\n", BENCH_WARMUP);
+	printf(" -W width          Width of framebuffer (default: 800).\n");
+	printf(" -H height         Height of framebuffer (default: 600).\n");
+	printf(" -b triangles      Maximal number of triangles drawn in one frame\n");
+	printf("                   (default: %d).\n", RENDER_TRIANGLE_BUDGET);
+	printf(" -t threads        Number of threads used for processing of mesh.\n");
+	printf(" -d                Print debug prints.\n");
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct CTX *ctx;
+	struct Offscreen offscreen;
+	struct Renderer renderer;
+	int opt, i, nframes = BENCH_FRAMES, warmup = BENCH_WARMUP;
+	int width = 800, height = 600, ret = EXIT_FAILURE;
+	double *times = NULL, t0, t1, total = 0.0, distance;
+	uint64_t triangles = 0;
+
+	ctx = (struct CTX*)calloc(1, sizeof(CTX));
+	if(ctx == NULL) {
+		printf("Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	init_CTX(ctx);
+
+	while( (opt = getopt(argc, argv, "hdn:w:W:H:b:t:")) != -1) {
+		switch(opt) {
+		case 'h':
+			print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+		case 'd':
+			ctx->print_debug = 1;
+			break;
+		case 'n':
+			nframes = atoi(optarg);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			break;
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 'b':
+			ctx->display_budget = strtoull(optarg, NULL, 10);
+			break;
+		case 't':
+			ctx->nthreads = atoi(optarg);
+			break;
+		default:
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if( (optind + 1) != argc || nframes < 1 || warmup < 0 || width < 1 || height < 1) {
+		print_help(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	ctx->my_filename = strdup(argv[optind]);
+
+	times = (double*)malloc(nframes * sizeof(double));
+	memset(&offscreen, 0, sizeof(offscreen));
+
+	if(times == NULL || prepare_mesh(ctx) != 1 ||
+			offscreen_init(&offscreen, width, height) != 1) {
+		goto end;
+	}
+
+	/* Upload mesh and wait for octree */
+	t0 = time_now();
+	if(render_init(&renderer, ctx) != 1) {
+		goto end;
+	}
+	while(renderer.octree_thread_running == 1) {
+		if(render_update(&renderer) == 0) {
+			usleep(1000);
+		}
+	}
+	glFinish();
+	t1 = time_now();
+	printf("vertices: %lu, faces: %lu, upload and octree: %.3f s\n",
+			(unsigned long)ctx->nvertices, (unsigned long)ctx->nquads, t1 - t0);
+
+	distance = renderer.camera.distance;
+
+	/* Level of detail is adjusted to budget during warm-up */
+	for(i = 0; i < warmup; i++) {
+		camera_path(&renderer.camera, distance, 0, nframes);
+		render_frame(&renderer, width, height);
+	}
+	glFinish();
+
+	for(i = 0; i < nframes; i++) {
+		camera_path(&renderer.camera, distance, i, nframes);
+		t0 = time_now();
+		render_frame(&renderer, width, height);
+		glFinish();
+		t1 = time_now();
+		times[i] = t1 - t0;
+		total += times[i];
+		triangles += renderer.stats.triangles;
+		if(ctx->print_debug) {
+			printf("frame: %d, time: %.3f ms, triangles: %lu, nodes: %u, draw calls: %u\n",
+					i, 1e3 * times[i], (unsigned long)renderer.stats.triangles,
+					renderer.stats.nodes, renderer.stats.draw_calls);
+		}
+	}
+
+	qsort(times, nframes, sizeof(double), compare_double);
+
+	printf("frames: %d, size: %dx%d\n", nframes, width, height);
+	printf("frame time min: %.3f ms, median: %.3f ms, p99: %.3f ms, mean: %.3f ms\n",
+			1e3 * times[0],
+			1e3 * times[nframes / 2],
+			1e3 * times[(int)ceil(0.99 * nframes) - 1],
+			1e3 * total / nframes);
+	printf("triangles per frame: %.0f, triangles per second: %.0f\n",
+			(double)triangles / nframes, (double)triangles / total);
+
+	render_free(&renderer);
+	ret = EXIT_SUCCESS;
+
+end:
+	offscreen_free(&offscreen);
+	if(times != NULL) free(times);
+	clear_CTX(ctx);
+	free(ctx);
+
+	return ret;
+}
@@ -0,0 +1,237 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <verse.h>
+
+#include "main.h"
+#include "uploader.h"
+#include "trace.h"
+#include "download.h"
+#include "verse_stub.h"
+
+/* Default one-way latency of link in milliseconds */
+#define BENCH_LATENCY	1.0
+
+/* Default bandwidth of link in megabits per second */
+#define BENCH_BANDWIDTH	100.0
+
+static void print_help(char *prog_name)
+{
+	printf("\n Usage: %s [options] filename\n", prog_name);
+	printf("\n");
+	printf(" This program uploads PLY model to Verse server simulated in the\n");
+	printf(" same process and reports throughput and time of upload.\n");
+	printf(" The stand-in replaces client API of libverse, so real sending,\n");
+	printf(" queues and acknowledgements of libverse are not measured; only\n");
+	printf(" the uploader and the simulated link are.\n");
+	printf("\n");
+	printf(" Options:\n");
+	printf(" -L latency        One-way latency of link in milliseconds\n");
+	printf("                   (default: %g).\n", BENCH_LATENCY);
+	printf(" -B bandwidth      Bandwidth of link in megabits per second,\n");
+	printf("                   0 is unlimited (default: %g).\n", BENCH_BANDWIDTH);
+	printf(" -x loss           Probability of loss of command (0 - 1).\n");
+	printf(" -S seed           Seed of generator of losses.\n");
+	printf(" -q bits           Upload vertices quantized with given number of bits.\n");
+	printf(" -P props          Comma separated list of uploaded vertex properties.\n");
+	printf(" -C                Upload faces reordered to meshlets with bounds.\n");
+	printf(" -N                Do not compute vertex normals.\n");
+	printf(" -t threads        Number of threads used for processing of mesh.\n");
+	printf(" -M path           Write metrics to file or UNIX socket during upload.\n");
+	printf(" -F format         Format of metrics: prometheus or json.\n");
+	printf(" -T filename       Write Chrome trace events of upload to file.\n");
+	printf(" -V                Verify mesh received back from server.\n");
+	printf(" -o filename       Download uploaded mesh in the next session to PLY file.\n");
+	printf(" -d                Print debug prints.\n");
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct CTX *ctx;
+	struct VerseStubConfig config;
+	struct VerseStubStats stats;
+	struct Metrics *metrics;
+	const char *output_filename = NULL;
+	uint64_t items, acked, bytes;
+	double upload_time, total_time;
+	int opt, ret = EXIT_FAILURE;
+
+	ctx = (struct CTX*)calloc(1, sizeof(CTX));
+	if(ctx == NULL) {
+		printf("Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	init_CTX(ctx);
+
+	config.latency = BENCH_LATENCY * 1e-3;
+	config.bandwidth = BENCH_BANDWIDTH * 1e6 / 8.0;
+	config.loss = 0.0;
+	config.seed = 1;
+
+	while( (opt = getopt(argc, argv, "hdL:B:x:S:q:P:CNt:M:F:T:Vo:")) != -1) {
+		switch(opt) {
+		case 'h':
+			print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+		case 'd':
+			ctx->print_debug = 1;
+			break;
+		case 'L':
+			config.latency = atof(optarg) * 1e-3;
+			break;
+		case 'B':
+			config.bandwidth = atof(optarg) * 1e6 / 8.0;
+			break;
+		case 'x':
+			config.loss = atof(optarg);
+			break;
+		case 'S':
+			config.seed = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'q':
+			ctx->quant_bits = atoi(optarg);
+			break;
+		case 'P':
+			ctx->my_props = strdup(optarg);
+			break;
+		case 'C':
+			ctx->meshlets = 1;
+			break;
+		case 'N':
+			ctx->compute_normals = 0;
+			break;
+		case 't':
+			ctx->nthreads = atoi(optarg);
+			break;
+		case 'M':
+			ctx->metrics.path = strdup(optarg);
+			break;
+		case 'F':
+			ctx->metrics.format = metrics_parse_format(optarg);
+			if(ctx->metrics.format == -1) {
+				printf("ERROR: Unknown format of metrics: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'T':
+			if(trace_init(optarg) != 1) {
+				printf("ERROR: Unable to start tracing to file: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			trace_thread_name("main");
+			break;
+		case 'V':
+			ctx->verify = 1;
+			break;
+		case 'o':
+			output_filename = optarg;
+			break;
+		default:
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if( (optind + 1) != argc || config.latency < 0.0 || config.bandwidth < 0.0 ||
+			config.loss < 0.0 || config.loss >= 1.0) {
+		print_help(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	ctx->my_filename = strdup(argv[optind]);
+	ctx->my_verse_server = strdup("localhost");
+	ctx->my_username = strdup("bench");
+	ctx->my_password = strdup("bench");
+	ctx->exit_after_upload = 1;
+
+	if(metrics_start(&ctx->metrics) != 1 || prepare_mesh(ctx) != 1) {
+		goto end;
+	}
+
+	verse_stub_configure(&config);
+
+	if(uploader_session(ctx) != 1) {
+		goto end;
+	}
+
+	verse_stub_get_stats(&stats);
+	metrics = &ctx->metrics;
+	metrics_stop(metrics);
+	items = metrics_get(&metrics->items_queued);
+	acked = metrics_get(&metrics->items_acked);
+	bytes = metrics_get(&metrics->bytes_queued);
+
+	if(metrics_phase_reached(metrics, METRICS_UPLOAD_DONE) != 1) {
+		printf("ERROR: Upload was not finished, items: %lu/%lu\n",
+				(unsigned long)acked, (unsigned long)items);
+		goto end;
+	}
+
+	upload_time = metrics_duration(metrics, METRICS_LAYERS_CREATED, METRICS_UPLOAD_DONE);
+	total_time = metrics_duration(metrics, METRICS_CONNECT_REQUEST, METRICS_UPLOAD_DONE);
+
+	printf("link: latency: %g ms, bandwidth: %g Mbit/s, loss: %g\n",
+			config.latency * 1e3, config.bandwidth * 8.0 / 1e6, config.loss);
+	printf("items: %lu, stored: %lu, rejected: %lu, retransmissions: %lu\n",
+			(unsigned long)items,
+			(unsigned long)stats.items,
+			(unsigned long)stats.rejected,
+			(unsigned long)stats.retransmissions);
+	printf("bytes: values: %lu, sent: %lu, received: %lu\n",
+			(unsigned long)bytes,
+			(unsigned long)stats.bytes_in,
+			(unsigned long)stats.bytes_out);
+	printf("time: connect: %.3f s, upload: %.3f s, completion: %.3f s\n",
+			metrics_duration(metrics, METRICS_CONNECT_REQUEST, METRICS_CONNECT_ACCEPT),
+			upload_time, total_time);
+	if(upload_time > 0.0) {
+		printf("throughput: %.0f items/s, %.0f bytes/s of values, %.0f bytes/s sent\n",
+				items / upload_time,
+				bytes / upload_time,
+				stats.bytes_in / upload_time);
+	}
+
+	ret = (stats.rejected == 0 && stats.items == items) ?
+			EXIT_SUCCESS : EXIT_FAILURE;
+
+	/* Download uploaded mesh node in the next session */
+	if(output_filename != NULL) {
+		ctx->download = download_create((uint32_t)ctx->my_mesh_node_id,
+				output_filename, DOWNLOAD_IDLE_TIMEOUT);
+		if(ctx->download == NULL || uploader_session(ctx) != 1) {
+			ret = EXIT_FAILURE;
+		}
+	}
+
+end:
+	clear_CTX(ctx);
+	free(ctx);
+
+	return ret;
+}
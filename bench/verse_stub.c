@@ -0,0 +1,996 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+/*
+ * This file implements subset of Verse client API used by uploader. It
+ * does not open any socket: commands are passed to simple server running
+ * in the same process through simulated link with latency, bandwidth and
+ * loss. Commands in flight are stored in binary heap ordered by time of
+ * delivery and they are processed, when vrs_callback_update() is called.
+ * Server replies with time of delivery computed from time of arrival of
+ * command, so results do not depend on frequency of updates of client.
+ * Layers and their values are kept between sessions, so mesh uploaded
+ * in one session can be downloaded in the next one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <verse.h>
+
+#include "verse_stub.h"
+
+/**
+ * Commands passed between client and server
+ */
+typedef enum StubCmd {
+	STUB_CONNECT_ACCEPT = 0,
+	STUB_CONNECT_TERMINATE,
+	STUB_USER_AUTHENTICATE,
+	STUB_NODE_CREATE,
+	STUB_NODE_SUBSCRIBE,
+	STUB_NODE_LINK,
+	STUB_TAGGROUP_CREATE,
+	STUB_TAGGROUP_SUBSCRIBE,
+	STUB_TAG_CREATE,
+	STUB_TAG_SET_VALUE,
+	STUB_LAYER_CREATE,
+	STUB_LAYER_SUBSCRIBE,
+	STUB_LAYER_SET_VALUE
+} StubCmd;
+
+/**
+ * Command in flight. Meaning of generic fields depends on command.
+ */
+typedef struct StubMessage {
+	/* Time of delivery */
+	double time;
+	/* Order of sending; it keeps order of commands delivered at once */
+	uint64_t seq;
+	uint32_t node_id;
+	/* Parent node, child node or item */
+	uint32_t id;
+	/* Layer or tag group */
+	uint16_t layer_id;
+	/* Parent layer or tag */
+	uint16_t sub_id;
+	uint16_t type;
+	uint8_t cmd;
+	uint8_t to_server;
+	uint8_t data_type;
+	uint8_t count;
+	unsigned char value[VERSE_STUB_MAX_VALUE];
+} StubMessage;
+
+/**
+ * One direction of link
+ */
+typedef struct StubLink {
+	/* Time, when last command leaves sender */
+	double busy_until;
+} StubLink;
+
+/**
+ * Layer created at server
+ */
+typedef struct StubLayer {
+	uint32_t node_id;
+	uint16_t layer_id;
+	uint16_t type;
+	uint8_t data_type;
+	uint8_t count;
+	int subscribed;
+	/* Values of items indexed by ID of item */
+	unsigned char *items;
+	/* Flags of stored items */
+	unsigned char *stored;
+	uint64_t nitems;
+	uint64_t capacity;
+} StubLayer;
+
+/**
+ * State of server and the only session
+ */
+typedef struct StubServer {
+	struct VerseStubConfig config;
+	struct VerseStubStats stats;
+	struct StubLink up;
+	struct StubLink down;
+	/* Binary heap of commands in flight */
+	struct StubMessage *heap;
+	size_t heap_size;
+	size_t heap_capacity;
+	uint64_t seq;
+	uint32_t random;
+	int connected;
+	char username[VRS_MAX_USERNAME_LENGTH + 1];
+	uint32_t next_node_id;
+	uint16_t next_taggroup_id;
+	uint16_t next_tag_id;
+	struct StubLayer *layers;
+	int nlayers;
+	int layers_capacity;
+} StubServer;
+
+static struct StubServer server;
+
+/* Callback functions registered by client */
+static void (*cb_connect_accept)(const uint8_t session_id, const uint16_t user_id, const uint32_t avatar_id);
+static void (*cb_connect_terminate)(const uint8_t session_id, const uint8_t error_num);
+static void (*cb_user_authenticate)(const uint8_t session_id, const char *username, const uint8_t auth_methods_count, const uint8_t *methods);
+static void (*cb_node_create)(const uint8_t session_id, const uint32_t node_id, const uint32_t parent_id, const uint16_t user_id, const uint16_t type);
+static void (*cb_taggroup_create)(const uint8_t session_id, const uint32_t node_id, const uint16_t taggroup_id, const uint16_t type);
+static void (*cb_tag_create)(const uint8_t session_id, const uint32_t node_id, const uint16_t taggroup_id, const uint16_t tag_id, const uint8_t data_type, const uint8_t count, const uint16_t type);
+static void (*cb_tag_set_value)(const uint8_t session_id, const uint32_t node_id, const uint16_t taggroup_id, const uint16_t tag_id, const uint8_t data_type, const uint8_t count, const void *value);
+static void (*cb_layer_create)(const uint8_t session_id, const uint32_t node_id, const uint16_t parent_layer_id, const uint16_t layer_id, const uint8_t data_type, const uint8_t count, const uint16_t type);
+static void (*cb_layer_set_value)(const uint8_t session_id, const uint32_t node_id, const uint16_t layer_id, const uint32_t item_id, const uint8_t data_type, const uint8_t count, const void *value);
+
+static double stub_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief This function returns pseudo-random number in range [0, 1)
+ * (xorshift32)
+ */
+static double stub_random(void)
+{
+	uint32_t x = server.random;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	server.random = x;
+
+	return (x >> 8) * (1.0 / 16777216.0);
+}
+
+static size_t value_size(uint8_t data_type, uint8_t count)
+{
+	switch(data_type) {
+	case VRS_VALUE_TYPE_UINT8:
+		return count;
+	case VRS_VALUE_TYPE_UINT16:
+	case VRS_VALUE_TYPE_REAL16:
+		return 2*count;
+	case VRS_VALUE_TYPE_UINT32:
+	case VRS_VALUE_TYPE_REAL32:
+		return 4*count;
+	case VRS_VALUE_TYPE_UINT64:
+	case VRS_VALUE_TYPE_REAL64:
+		return 8*count;
+	}
+	return 0;
+}
+
+/**
+ * @brief This function returns approximate size of command on wire
+ */
+static size_t message_size(const struct StubMessage *msg)
+{
+	switch(msg->cmd) {
+	case STUB_LAYER_SET_VALUE:
+		return VERSE_STUB_CMD_HEADER + 4 + 2 + 4 + value_size(msg->data_type, msg->count);
+	case STUB_TAG_SET_VALUE:
+		return VERSE_STUB_CMD_HEADER + 4 + 2 + 2 + value_size(msg->data_type, msg->count);
+	case STUB_USER_AUTHENTICATE:
+		return VERSE_STUB_CMD_HEADER + 1 + VRS_MAX_USERNAME_LENGTH;
+	}
+	return VERSE_STUB_CMD_HEADER + 14;
+}
+
+static int message_before(const struct StubMessage *a, const struct StubMessage *b)
+{
+	return (a->time < b->time || (a->time == b->time && a->seq < b->seq)) ? 1 : 0;
+}
+
+static int heap_push(const struct StubMessage *msg)
+{
+	size_t i;
+
+	if(server.heap_size == server.heap_capacity) {
+		size_t capacity = (server.heap_capacity == 0) ? 1024 : 2*server.heap_capacity;
+		struct StubMessage *heap = (struct StubMessage*)realloc(server.heap,
+				capacity * sizeof(struct StubMessage));
+		if(heap == NULL) {
+			return 0;
+		}
+		server.heap = heap;
+		server.heap_capacity = capacity;
+	}
+
+	/* Sift up */
+	i = server.heap_size++;
+	while(i > 0 && message_before(msg, &server.heap[(i - 1)/2]) == 1) {
+		server.heap[i] = server.heap[(i - 1)/2];
+		i = (i - 1)/2;
+	}
+	server.heap[i] = *msg;
+
+	return 1;
+}
+
+static void heap_pop(struct StubMessage *msg)
+{
+	struct StubMessage last;
+	size_t i = 0;
+
+	*msg = server.heap[0];
+	last = server.heap[--server.heap_size];
+
+	/* Sift down */
+	for(;;) {
+		size_t child = 2*i + 1;
+		if(child >= server.heap_size) break;
+		if(child + 1 < server.heap_size &&
+				message_before(&server.heap[child + 1], &server.heap[child]) == 1) {
+			child++;
+		}
+		if(message_before(&server.heap[child], &last) == 0) break;
+		server.heap[i] = server.heap[child];
+		i = child;
+	}
+	if(server.heap_size > 0) {
+		server.heap[i] = last;
+	}
+}
+
+/**
+ * @brief This function sends command through link. Command waits until
+ * link is free, it is transmitted with bandwidth of link and it arrives
+ * after latency. Lost command is transmitted again after timeout of
+ * retransmission.
+ *
+ * @param time	The time of sending
+ * @return VRS_SUCCESS on success, VRS_FAILURE on failure
+ */
+static int link_send(struct StubMessage *msg, int to_server, double time)
+{
+	struct StubLink *link = (to_server == 1) ? &server.up : &server.down;
+	size_t size = message_size(msg);
+	double transmit = (server.config.bandwidth > 0.0) ? size / server.config.bandwidth : 0.0;
+	double rto = 2.0*server.config.latency;
+	double depart;
+
+	if(rto < VERSE_STUB_MIN_RTO) rto = VERSE_STUB_MIN_RTO;
+
+	depart = ((link->busy_until > time) ? link->busy_until : time) + transmit;
+	link->busy_until = depart;
+	msg->time = depart + server.config.latency;
+
+	while(server.config.loss > 0.0 && stub_random() < server.config.loss) {
+		server.stats.retransmissions++;
+		msg->time += rto + transmit;
+		link->busy_until += transmit;
+	}
+
+	msg->to_server = (uint8_t)to_server;
+	msg->seq = server.seq++;
+
+	if(to_server == 1) {
+		server.stats.bytes_in += size;
+	} else {
+		server.stats.bytes_out += size;
+	}
+
+	return (heap_push(msg) == 1) ? VRS_SUCCESS : VRS_FAILURE;
+}
+
+/**
+ * @brief This function sends command from client to server
+ */
+static int client_send(uint8_t session_id, struct StubMessage *msg)
+{
+	if(session_id != 0 || server.connected == 0) {
+		return VRS_FAILURE;
+	}
+
+	return link_send(msg, 1, stub_time());
+}
+
+static struct StubLayer *find_layer(uint32_t node_id, uint16_t layer_id)
+{
+	int i;
+
+	for(i = 0; i < server.nlayers; i++) {
+		if(server.layers[i].node_id == node_id && server.layers[i].layer_id == layer_id) {
+			return &server.layers[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct StubLayer *add_layer(const struct StubMessage *msg)
+{
+	struct StubLayer *layer;
+
+	if(server.nlayers == server.layers_capacity) {
+		int capacity = (server.layers_capacity == 0) ? 16 : 2*server.layers_capacity;
+		layer = (struct StubLayer*)realloc(server.layers, capacity * sizeof(struct StubLayer));
+		if(layer == NULL) {
+			return NULL;
+		}
+		server.layers = layer;
+		server.layers_capacity = capacity;
+	}
+
+	layer = &server.layers[server.nlayers];
+	layer->node_id = msg->node_id;
+	layer->layer_id = (uint16_t)server.nlayers;
+	layer->type = msg->type;
+	layer->data_type = msg->data_type;
+	layer->count = msg->count;
+	layer->subscribed = 0;
+	layer->items = NULL;
+	layer->stored = NULL;
+	layer->nitems = 0;
+	layer->capacity = 0;
+	server.nlayers++;
+
+	return layer;
+}
+
+/**
+ * @brief This function stores value of item of layer
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int layer_store(struct StubLayer *layer, const struct StubMessage *msg)
+{
+	size_t size = value_size(layer->data_type, layer->count);
+
+	if(msg->id >= layer->capacity) {
+		uint64_t capacity = (layer->capacity > 0) ? 2*layer->capacity : 1024;
+		unsigned char *items, *stored;
+
+		while(capacity <= msg->id) capacity *= 2;
+		items = (unsigned char*)realloc(layer->items, capacity * size);
+		if(items == NULL) {
+			return 0;
+		}
+		layer->items = items;
+		stored = (unsigned char*)realloc(layer->stored, capacity);
+		if(stored == NULL) {
+			return 0;
+		}
+		memset(stored + layer->capacity, 0, capacity - layer->capacity);
+		layer->stored = stored;
+		layer->capacity = capacity;
+	}
+
+	memcpy(layer->items + msg->id * size, msg->value, size);
+	layer->stored[msg->id] = 1;
+	if(msg->id >= layer->nitems) {
+		layer->nitems = (uint64_t)msg->id + 1;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function sends all stored items of layer to client
+ */
+static void layer_send_items(struct StubLayer *layer, struct StubMessage *reply)
+{
+	size_t size = value_size(layer->data_type, layer->count);
+	double time = reply->time;
+	uint64_t i;
+
+	reply->cmd = STUB_LAYER_SET_VALUE;
+	reply->data_type = layer->data_type;
+	reply->count = layer->count;
+	for(i = 0; i < layer->nitems; i++) {
+		if(layer->stored[i] == 0) {
+			continue;
+		}
+		reply->id = (uint32_t)i;
+		memcpy(reply->value, layer->items + i * size, size);
+		link_send(reply, 0, time);
+	}
+}
+
+/**
+ * @brief This function handles command received by server. Commands
+ * creating nodes, tag groups, tags and layers are confirmed to client
+ * and values of subscribed layers are sent back to client.
+ */
+static void server_handle(struct StubMessage *msg)
+{
+	struct StubMessage reply = *msg;
+	struct StubLayer *layer;
+	int i;
+
+	server.stats.commands++;
+
+	switch(msg->cmd) {
+	case STUB_CONNECT_TERMINATE:
+		reply.count = VRS_CONN_TERM_CLIENT;
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_USER_AUTHENTICATE:
+		if(msg->data_type == VRS_UA_METHOD_PASSWORD) {
+			reply.cmd = STUB_CONNECT_ACCEPT;
+			reply.node_id = VERSE_STUB_AVATAR_ID;
+			reply.type = VERSE_STUB_USER_ID;
+		} else {
+			/* Only password method is supported */
+			reply.count = 1;
+			reply.value[0] = VRS_UA_METHOD_PASSWORD;
+		}
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_NODE_CREATE:
+		reply.node_id = server.next_node_id++;
+		reply.id = VERSE_STUB_AVATAR_ID;
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_TAGGROUP_CREATE:
+		reply.layer_id = server.next_taggroup_id++;
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_TAG_CREATE:
+		reply.sub_id = server.next_tag_id++;
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_TAG_SET_VALUE:
+		link_send(&reply, 0, msg->time);
+		break;
+	case STUB_LAYER_CREATE:
+		layer = add_layer(msg);
+		if(layer != NULL) {
+			reply.layer_id = layer->layer_id;
+			link_send(&reply, 0, msg->time);
+		}
+		break;
+	case STUB_NODE_SUBSCRIBE:
+		/* Send layers of existing node */
+		for(i = 0; i < server.nlayers; i++) {
+			layer = &server.layers[i];
+			if(layer->node_id == msg->node_id) {
+				reply.cmd = STUB_LAYER_CREATE;
+				reply.layer_id = layer->layer_id;
+				reply.sub_id = (uint16_t)-1;
+				reply.data_type = layer->data_type;
+				reply.count = layer->count;
+				reply.type = layer->type;
+				link_send(&reply, 0, msg->time);
+			}
+		}
+		break;
+	case STUB_LAYER_SUBSCRIBE:
+		layer = find_layer(msg->node_id, msg->layer_id);
+		if(layer != NULL && layer->subscribed == 0) {
+			layer->subscribed = 1;
+			layer_send_items(layer, &reply);
+		}
+		break;
+	case STUB_LAYER_SET_VALUE:
+		layer = find_layer(msg->node_id, msg->layer_id);
+		if(layer == NULL || layer->data_type != msg->data_type || layer->count != msg->count ||
+				layer_store(layer, msg) != 1) {
+			server.stats.rejected++;
+			break;
+		}
+		server.stats.items++;
+		if(layer->subscribed == 1) {
+			link_send(&reply, 0, msg->time);
+		}
+		break;
+	default:
+		/* Subscriptions of nodes and links are accepted silently */
+		break;
+	}
+}
+
+/**
+ * @brief This function calls callback function of client registered
+ * for received command
+ */
+static void client_handle(const struct StubMessage *msg)
+{
+	switch(msg->cmd) {
+	case STUB_CONNECT_ACCEPT:
+		if(cb_connect_accept != NULL) {
+			cb_connect_accept(0, msg->type, msg->node_id);
+		}
+		break;
+	case STUB_CONNECT_TERMINATE:
+		server.connected = 0;
+		if(cb_connect_terminate != NULL) {
+			cb_connect_terminate(0, msg->count);
+		}
+		break;
+	case STUB_USER_AUTHENTICATE:
+		if(cb_user_authenticate != NULL) {
+			cb_user_authenticate(0, (msg->data_type == 0 && server.username[0] == '\0') ?
+					NULL : server.username, msg->count, msg->value);
+		}
+		break;
+	case STUB_NODE_CREATE:
+		if(cb_node_create != NULL) {
+			cb_node_create(0, msg->node_id, msg->id, VERSE_STUB_USER_ID, msg->type);
+		}
+		break;
+	case STUB_TAGGROUP_CREATE:
+		if(cb_taggroup_create != NULL) {
+			cb_taggroup_create(0, msg->node_id, msg->layer_id, msg->type);
+		}
+		break;
+	case STUB_TAG_CREATE:
+		if(cb_tag_create != NULL) {
+			cb_tag_create(0, msg->node_id, msg->layer_id, msg->sub_id,
+					msg->data_type, msg->count, msg->type);
+		}
+		break;
+	case STUB_TAG_SET_VALUE:
+		if(cb_tag_set_value != NULL) {
+			cb_tag_set_value(0, msg->node_id, msg->layer_id, msg->sub_id,
+					msg->data_type, msg->count, msg->value);
+		}
+		break;
+	case STUB_LAYER_CREATE:
+		if(cb_layer_create != NULL) {
+			cb_layer_create(0, msg->node_id, msg->sub_id, msg->layer_id,
+					msg->data_type, msg->count, msg->type);
+		}
+		break;
+	case STUB_LAYER_SET_VALUE:
+		if(cb_layer_set_value != NULL) {
+			cb_layer_set_value(0, msg->node_id, msg->layer_id, msg->id,
+					msg->data_type, msg->count, msg->value);
+		}
+		break;
+	}
+}
+
+/**
+ * @brief This function sets parameters of simulated link. It has to be
+ * called before vrs_send_connect_request().
+ */
+void verse_stub_configure(const struct VerseStubConfig *config)
+{
+	server.config = *config;
+}
+
+/**
+ * @brief This function returns statistics collected by server
+ */
+void verse_stub_get_stats(struct VerseStubStats *stats)
+{
+	*stats = server.stats;
+}
+
+int32_t vrs_send_connect_request(const char *hostname,
+		const char *service,
+		const uint16_t flags,
+		uint8_t *session_id)
+{
+	struct StubMessage msg;
+	int i;
+
+	(void)service;
+	(void)flags;
+
+	if(hostname == NULL || server.connected == 1) {
+		return VRS_FAILURE;
+	}
+
+	memset(&server.stats, 0, sizeof(server.stats));
+	memset(&server.up, 0, sizeof(server.up));
+	memset(&server.down, 0, sizeof(server.down));
+	server.random = (server.config.seed != 0) ? server.config.seed : 1;
+	server.heap_size = 0;
+	server.username[0] = '\0';
+	if(server.next_node_id == 0) {
+		server.next_node_id = VERSE_STUB_AVATAR_ID + 1;
+	}
+	for(i = 0; i < server.nlayers; i++) {
+		server.layers[i].subscribed = 0;
+	}
+	server.connected = 1;
+	*session_id = 0;
+
+	/* Server asks for username */
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_USER_AUTHENTICATE;
+	msg.count = 1;
+	msg.value[0] = VRS_UA_METHOD_PASSWORD;
+
+	return link_send(&msg, 0, stub_time());
+}
+
+int32_t vrs_send_connect_terminate(const uint8_t session_id)
+{
+	struct StubMessage msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_CONNECT_TERMINATE;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_user_authenticate(const uint8_t session_id,
+		const char *username,
+		const uint8_t auth_type,
+		const char *data)
+{
+	struct StubMessage msg;
+
+	(void)data;
+
+	if(username == NULL) {
+		return VRS_FAILURE;
+	}
+
+	strncpy(server.username, username, VRS_MAX_USERNAME_LENGTH);
+	server.username[VRS_MAX_USERNAME_LENGTH] = '\0';
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_USER_AUTHENTICATE;
+	msg.data_type = auth_type;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_callback_update(const uint8_t session_id)
+{
+	double now = stub_time();
+	struct StubMessage msg;
+
+	if(session_id != 0) {
+		return VRS_FAILURE;
+	}
+
+	while(server.heap_size > 0 && server.heap[0].time <= now) {
+		heap_pop(&msg);
+		if(msg.to_server == 1) {
+			server_handle(&msg);
+		} else {
+			client_handle(&msg);
+		}
+	}
+
+	return VRS_SUCCESS;
+}
+
+char *vrs_strerror(const uint32_t error_num)
+{
+	return (error_num == VRS_SUCCESS) ? "Success" : "Failure";
+}
+
+int32_t vrs_send_node_create(const uint8_t session_id,
+		const uint8_t prio,
+		const uint16_t type)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_NODE_CREATE;
+	msg.type = type;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_node_subscribe(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint32_t version,
+		const uint32_t crc32)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+	(void)version;
+	(void)crc32;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_NODE_SUBSCRIBE;
+	msg.node_id = node_id;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_node_link(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t parent_node_id,
+		const uint32_t child_node_id)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_NODE_LINK;
+	msg.node_id = parent_node_id;
+	msg.id = child_node_id;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_taggroup_create(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t type)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_TAGGROUP_CREATE;
+	msg.node_id = node_id;
+	msg.type = type;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_taggroup_subscribe(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint32_t version,
+		const uint32_t crc32)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+	(void)version;
+	(void)crc32;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_TAGGROUP_SUBSCRIBE;
+	msg.node_id = node_id;
+	msg.layer_id = taggroup_id;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_tag_create(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t type)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_TAG_CREATE;
+	msg.node_id = node_id;
+	msg.layer_id = taggroup_id;
+	msg.data_type = data_type;
+	msg.count = count;
+	msg.type = type;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_tag_set_value(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t tag_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value)
+{
+	struct StubMessage msg;
+	size_t size = value_size(data_type, count);
+
+	(void)prio;
+
+	if(size == 0 || size > VERSE_STUB_MAX_VALUE) {
+		return VRS_FAILURE;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_TAG_SET_VALUE;
+	msg.node_id = node_id;
+	msg.layer_id = taggroup_id;
+	msg.sub_id = tag_id;
+	msg.data_type = data_type;
+	msg.count = count;
+	memcpy(msg.value, value, size);
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_layer_create(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t parent_layer_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t type)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_LAYER_CREATE;
+	msg.node_id = node_id;
+	msg.sub_id = parent_layer_id;
+	msg.data_type = data_type;
+	msg.count = count;
+	msg.type = type;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_layer_subscribe(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t version,
+		const uint32_t crc32)
+{
+	struct StubMessage msg;
+
+	(void)prio;
+	(void)version;
+	(void)crc32;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = STUB_LAYER_SUBSCRIBE;
+	msg.node_id = node_id;
+	msg.layer_id = layer_id;
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_send_layer_set_value(const uint8_t session_id,
+		const uint8_t prio,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value)
+{
+	struct StubMessage msg;
+	size_t size = value_size(data_type, count);
+
+	(void)prio;
+
+	if(size == 0 || size > VERSE_STUB_MAX_VALUE) {
+		return VRS_FAILURE;
+	}
+
+	msg.cmd = STUB_LAYER_SET_VALUE;
+	msg.node_id = node_id;
+	msg.id = item_id;
+	msg.layer_id = layer_id;
+	msg.sub_id = 0;
+	msg.type = 0;
+	msg.data_type = data_type;
+	msg.count = count;
+	memcpy(msg.value, value, size);
+
+	return client_send(session_id, &msg);
+}
+
+int32_t vrs_register_receive_connect_accept(void (*func)(const uint8_t session_id,
+		const uint16_t user_id,
+		const uint32_t avatar_id))
+{
+	cb_connect_accept = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_connect_terminate(void (*func)(const uint8_t session_id,
+		const uint8_t error_num))
+{
+	cb_connect_terminate = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_user_authenticate(void (*func)(const uint8_t session_id,
+		const char *username,
+		const uint8_t auth_methods_count,
+		const uint8_t *methods))
+{
+	cb_user_authenticate = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_node_create(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint32_t parent_id,
+		const uint16_t user_id,
+		const uint16_t type))
+{
+	cb_node_create = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_taggroup_create(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t type))
+{
+	cb_taggroup_create = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_tag_create(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t tag_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t type))
+{
+	cb_tag_create = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_tag_set_value(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t tag_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value))
+{
+	cb_tag_set_value = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_layer_create(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t parent_layer_id,
+		const uint16_t layer_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t type))
+{
+	cb_layer_create = func;
+	return VRS_SUCCESS;
+}
+
+int32_t vrs_register_receive_layer_set_value(void (*func)(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value))
+{
+	cb_layer_set_value = func;
+	return VRS_SUCCESS;
+}
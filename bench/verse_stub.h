@@ -0,0 +1,84 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#ifndef VERSE_STUB_H_
+#define VERSE_STUB_H_
+
+/* Maximal size of value of one item or tag in bytes */
+#define VERSE_STUB_MAX_VALUE	32
+
+/* Minimal timeout of retransmission of lost packet in seconds */
+#define VERSE_STUB_MIN_RTO	0.001
+
+/* Approximate size of header of one command in bytes */
+#define VERSE_STUB_CMD_HEADER	2
+
+/* ID of avatar node of the only session */
+#define VERSE_STUB_AVATAR_ID	65536
+
+/* ID of user of the only session */
+#define VERSE_STUB_USER_ID	1001
+
+/**
+ * Parameters of simulated link between client and server. The same
+ * parameters are used for both directions.
+ */
+typedef struct VerseStubConfig {
+	/* One-way latency in seconds */
+	double latency;
+	/* Bandwidth in bytes per second (0 means unlimited) */
+	double bandwidth;
+	/* Probability of loss of command (0 - 1); lost command is delivered
+	 * again after timeout of retransmission */
+	double loss;
+	/* Seed of pseudo-random generator of losses */
+	uint32_t seed;
+} VerseStubConfig;
+
+/**
+ * Statistics collected by server
+ */
+typedef struct VerseStubStats {
+	/* Number of commands received by server */
+	uint64_t commands;
+	/* Number of items of layers stored by server */
+	uint64_t items;
+	/* Number of items rejected (unknown layer or wrong type) */
+	uint64_t rejected;
+	/* Number of bytes received by server */
+	uint64_t bytes_in;
+	/* Number of bytes sent by server */
+	uint64_t bytes_out;
+	/* Number of retransmissions of lost commands in both directions */
+	uint64_t retransmissions;
+} VerseStubStats;
+
+void verse_stub_configure(const struct VerseStubConfig *config);
+
+void verse_stub_get_stats(struct VerseStubStats *stats);
+
+#endif /* VERSE_STUB_H_ */
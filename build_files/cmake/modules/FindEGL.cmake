@@ -0,0 +1,36 @@
+# This module tries to find EGL library and include files
+#
+# EGL_INCLUDE_DIR, where to find EGL/egl.h
+# EGL_LIBRARY_DIR, where to find libEGL.so
+# EGL_LIBRARIES, the library to link against
+# EGL_FOUND, IF false, do not try to use EGL
+#
+
+FIND_PATH ( EGL_INCLUDE_DIR EGL/egl.h
+    /usr/include
+    /usr/local/include
+    /opt/local/include
+    /sw/include
+)
+
+FIND_LIBRARY ( EGL_LIBRARIES EGL
+    /usr/local/lib
+    /usr/local/lib64
+    /usr/lib
+    /usr/lib64
+)
+
+GET_FILENAME_COMPONENT( EGL_LIBRARY_DIR ${EGL_LIBRARIES} PATH )
+
+SET ( EGL_FOUND "NO" )
+IF ( EGL_INCLUDE_DIR )
+    IF ( EGL_LIBRARIES )
+        SET ( EGL_FOUND "YES" )
+    ENDIF ( EGL_LIBRARIES )
+ENDIF ( EGL_INCLUDE_DIR )
+
+MARK_AS_ADVANCED (
+    EGL_LIBRARY_DIR
+    EGL_INCLUDE_DIR
+    EGL_LIBRARIES
+)
@@ -0,0 +1,151 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <verse.h>
+
+#include "main.h"
+#include "simd.h"
+#include "parallel.h"
+#include "bbox.h"
+
+/**
+ * Data shared by threads computing bounding box
+ */
+typedef struct BBoxJob {
+	const mesh_real *coords[3];
+	struct BBox *boxes;
+} BBoxJob;
+
+static void bbox_init(struct BBox *bbox)
+{
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		bbox->min[i] = DBL_MAX;
+		bbox->max[i] = -DBL_MAX;
+	}
+}
+
+static void bbox_add_bbox(struct BBox *bbox, const struct BBox *other)
+{
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		if(other->min[i] < bbox->min[i]) bbox->min[i] = other->min[i];
+		if(other->max[i] > bbox->max[i]) bbox->max[i] = other->max[i];
+	}
+}
+
+/**
+ * @brief This function computes bounding box of vertices [first, last).
+ * Each axis is stored in separate array, so minimum and maximum are
+ * reduced by full width vectors and lanes are folded at the end.
+ */
+static void bbox_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct BBoxJob *job = (struct BBoxJob*)arg;
+	struct BBox *bbox = &job->boxes[thread_num];
+	int axis;
+
+	bbox_init(bbox);
+
+	for(axis = 0; axis < 3; axis++) {
+		const mesh_real *coords = job->coords[axis];
+		mesh_real min = (first < last) ? coords[first] : 0;
+		mesh_real max = min;
+		uint64_t i = first;
+
+#ifdef WITH_SIMD
+		if(i + SIMD_WIDTH <= last) {
+			simd_real vmin = simd_load(&coords[i]);
+			simd_real vmax = vmin;
+			mesh_real tmp_min[SIMD_WIDTH], tmp_max[SIMD_WIDTH];
+			int k;
+
+			for(i += SIMD_WIDTH; i + SIMD_WIDTH <= last; i += SIMD_WIDTH) {
+				simd_real v = simd_load(&coords[i]);
+				vmin = simd_min(vmin, v);
+				vmax = simd_max(vmax, v);
+			}
+
+			simd_store(tmp_min, vmin);
+			simd_store(tmp_max, vmax);
+			for(k = 0; k < SIMD_WIDTH; k++) {
+				if(tmp_min[k] < min) min = tmp_min[k];
+				if(tmp_max[k] > max) max = tmp_max[k];
+			}
+		}
+#endif
+
+		for(; i < last; i++) {
+			if(coords[i] < min) min = coords[i];
+			if(coords[i] > max) max = coords[i];
+		}
+
+		if(first < last) {
+			bbox->min[axis] = min;
+			bbox->max[axis] = max;
+		}
+	}
+}
+
+/**
+ * @brief This function computes axis aligned bounding box of all vertices
+ * of mesh. Vertices are split between threads and partial boxes are merged
+ * at the end.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int mesh_bbox(struct CTX *ctx, struct BBox *bbox)
+{
+	struct BBoxJob job;
+	int nthreads, t;
+
+	nthreads = parallel_threads(ctx->nthreads, ctx->nvertices);
+
+	job.coords[0] = ctx->vx;
+	job.coords[1] = ctx->vy;
+	job.coords[2] = ctx->vz;
+	job.boxes = (struct BBox*)calloc(nthreads, sizeof(struct BBox));
+	if(job.boxes == NULL) {
+		return 0;
+	}
+
+	if(parallel_for(nthreads, ctx->nvertices, bbox_range, &job) != 0) {
+		free(job.boxes);
+		return 0;
+	}
+
+	bbox_init(bbox);
+	for(t = 0; t < nthreads; t++) {
+		bbox_add_bbox(bbox, &job.boxes[t]);
+	}
+
+	free(job.boxes);
+
+	return 1;
+}
@@ -0,0 +1,209 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <verse.h>
+
+#include "main.h"
+#include "ply_loader.h"
+#include "ply_props.h"
+#include "normals.h"
+#include "quantize.h"
+#include "transform.h"
+#include "render.h"
+#include "trace.h"
+#include "verify.h"
+#include "download.h"
+#include "meshlet.h"
+#include "validate.h"
+
+/**
+ * @brief This function initialize context of client
+ *
+ * @param ctx
+ */
+void init_CTX(struct CTX *_ctx)
+{
+	_ctx->my_filename = NULL;
+	_ctx->my_props = NULL;
+	_ctx->nthreads = 0;
+	_ctx->compute_normals = 1;
+	_ctx->recenter = 0;
+	_ctx->scale = 1.0;
+	_ctx->my_axes = NULL;
+	_ctx->my_matrix = NULL;
+	_ctx->quant_bits = 0;
+	_ctx->meshlets = 0;
+	_ctx->check_only = 0;
+	_ctx->repair = 0;
+	_ctx->print_debug = 0;
+	_ctx->my_session_id = -1;
+	_ctx->my_username  = NULL;
+	_ctx->my_password  = NULL;
+	_ctx->my_verse_server = NULL;
+	_ctx->my_user_id = -1;
+	_ctx->my_avatar_id = -1;
+	_ctx->my_object_node_id  = -1;
+	_ctx->my_bbox_taggroup_id = -1;
+	_ctx->my_mesh_node_id  = -1;
+	_ctx->my_vertex_layer_id  = -1;
+	_ctx->my_face_layer_id = -1;
+	_ctx->nvertices = 0;
+	_ctx->vx = NULL;
+	_ctx->vy = NULL;
+	_ctx->vz = NULL;
+	_ctx->quantization = NULL;
+	_ctx->nquads = 0;
+	_ctx->quads = NULL;
+	_ctx->face_sizes = NULL;
+	_ctx->nprop_layers = 0;
+	_ctx->prop_layers = NULL;
+	_ctx->mesh_uploaded = 0;
+	metrics_init(&_ctx->metrics);
+	_ctx->exit_after_upload = 0;
+	_ctx->session_running = 0;
+	_ctx->verify = 0;
+	_ctx->idle_timeout = DOWNLOAD_IDLE_TIMEOUT;
+	_ctx->verifier = NULL;
+	_ctx->download = NULL;
+	_ctx->display = 0;
+	_ctx->display_live = 0;
+	_ctx->live_queue = NULL;
+	_ctx->live_resync = NULL;
+	_ctx->display_budget = 0;
+}
+
+/**
+ * @brief This function clear client context
+ *
+ * @param _ctx
+ */
+void clear_CTX(struct CTX *_ctx)
+{
+	if(_ctx->my_filename != NULL) free(_ctx->my_filename);
+	if(_ctx->my_props != NULL) free(_ctx->my_props);
+	if(_ctx->my_axes != NULL) free(_ctx->my_axes);
+	if(_ctx->my_matrix != NULL) free(_ctx->my_matrix);
+	if(_ctx->my_username != NULL) free(_ctx->my_username);
+	if(_ctx->my_password != NULL) free(_ctx->my_password);
+	if(_ctx->my_verse_server != NULL) free(_ctx->my_verse_server);
+	quantization_free(_ctx->quantization, &_ctx->arena);
+	ply_props_clear(_ctx);
+	render_live_free(_ctx);
+	verify_destroy(_ctx->verifier);
+	download_destroy(_ctx->download);
+	metrics_clear(&_ctx->metrics);
+	/* Vertices and faces are allocated in arena */
+	mesh_arena_free(&_ctx->arena);
+}
+
+/**
+ * @brief This function loads PLY file and prepares mesh for upload:
+ * mesh is validated, vertices are transformed, missing normals are
+ * computed and vertices are quantized, when it was requested. Only
+ * validation is done in check-only mode.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int prepare_mesh(struct CTX *ctx)
+{
+	struct PLYLoadTimes times;
+	struct stat st;
+	uint64_t start;
+
+	/* Load PLY file to memory */
+	start = trace_begin();
+	if(load_ply_file(ctx, ctx->my_filename, &times) != 1) {
+		printf("ERROR: Unable to load PLY file: %s\n", ctx->my_filename);
+		return 0;
+	}
+	trace_end("load", "load", start, ctx->nvertices);
+
+	/* Check mesh before anything is derived from it or sent to server */
+	if(validate_mesh(ctx) != 1) {
+		return 0;
+	}
+
+	metrics_add(&ctx->metrics.parse_ns,
+			(uint64_t)((times.header + times.alloc + times.vertices + times.faces) * 1e9));
+	if(stat(ctx->my_filename, &st) == 0) {
+		metrics_add(&ctx->metrics.bytes_read, (uint64_t)st.st_size);
+	}
+	metrics_add(&ctx->metrics.vertices, ctx->nvertices);
+	metrics_add(&ctx->metrics.faces, ctx->nquads);
+
+	if(ctx->check_only == 1) {
+		return 1;
+	}
+
+	/* Transform vertices before anything is derived from them */
+	if(transform_requested(ctx) == 1) {
+		start = trace_begin();
+		if(transform_mesh(ctx) != 1) {
+			printf("ERROR: Unable to transform mesh\n");
+			return 0;
+		}
+		trace_end("transform", "load", start, ctx->nvertices);
+	}
+
+	/* Compute vertex normals, when PLY file does not contain them */
+	if(ctx->compute_normals == 1 && ctx->nquads > 0 &&
+			ply_props_selected(ctx, "normal") == 1 &&
+			ply_props_find(ctx, LAYER_NORMALS_CT) == NULL) {
+		struct PropLayer *layer = ply_props_add(ctx, "normal", LAYER_NORMALS_CT,
+				VRS_VALUE_TYPE_REAL32, 3, ctx->nvertices);
+		start = trace_begin();
+		if(layer == NULL || compute_vertex_normals(ctx, (float*)layer->data) != 1) {
+			printf("ERROR: Unable to compute vertex normals\n");
+			return 0;
+		}
+		trace_end("normals", "load", start, ctx->nvertices);
+	}
+
+	/* Reorder faces to meshlets and compute their bounds */
+	if(ctx->meshlets == 1) {
+		start = trace_begin();
+		if(build_meshlets(ctx) != 1) {
+			printf("ERROR: Unable to build meshlets\n");
+			return 0;
+		}
+		trace_end("meshlets", "load", start, ctx->nquads);
+	}
+
+	/* Quantize vertices relative to bounding box of mesh */
+	if(ctx->quant_bits > 0) {
+		start = trace_begin();
+		ctx->quantization = quantize_vertices(ctx, ctx->quant_bits);
+		if(ctx->quantization == NULL) {
+			printf("ERROR: Unable to quantize vertices\n");
+			return 0;
+		}
+		trace_end("quantize", "load", start, ctx->nvertices);
+	}
+
+	return 1;
+}
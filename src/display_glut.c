@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -32,112 +33,38 @@
 #endif
 
 #include "main.h"
-
-static struct CTX *ctx = NULL;
+#include "spsc_queue.h"
+#include "render.h"
+#include "trace.h"
+#include "display_glut.h"
 
 /**
- * \brief Initialize OpenGL context
+ * State of mouse used for control of camera
  */
-static void gl_init(void)
-{
-	static float light_ambient[4] = {0.7, 0.7, 0.7, 1.0};
-	static float light_diffuse[4] = {0.9, 0.9, 0.9, 1.0};
-	static float light_specular[4] = {0.5, 0.5, 0.5, 1.0};
-	static float material_ambient[4] = {0.2, 0.2, 0.2, 1.0};
-	static float material_diffuse[4] = {0.4, 0.4, 0.4, 1.0};
-	static float material_specular[4] = {0.5, 0.5, 0.5, 1.0};
-
-	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glClearDepth(1.0f);
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glPointSize(2.0);
-	glLineWidth(1.0);
-	glEnable(GL_POINT_SMOOTH);
-	glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
-	glLightfv(GL_LIGHT0, GL_POSITION, light_specular);
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material_ambient);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material_diffuse);
-	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material_specular);
-	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 20.0);	/* TODO: add to ctx */
-}
+typedef struct Mouse {
+	int button;
+	int x;
+	int y;
+} Mouse;
+
+static struct CTX *ctx = NULL;
+static struct Renderer renderer;
+static struct Mouse mouse = {-1, 0, 0};
+static int redraw = 1;
 
 /**
  * \brief This function displays 3d scene
  */
 static void glut_on_display(void)
 {
-	uint64_t i, j;
-	uint64_t *quad;
-
-	glViewport(0, 0, ctx->window_width, ctx->window_height);
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluOrtho2D(0, ctx->window_width, 0, ctx->window_height);
-	glScalef(1, -1, 1);
-	glTranslatef(0, -ctx->window_height, 0);
-
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	/* BEGIN: Drawing of 2D stuff */
-
-	/* display_text_info(); */
-
-	/* END: Drawing of 2D stuff */
-
-	/* Set projection matrix for 3D stuff here */
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-	glLoadIdentity();
-	gluPerspective(45.0f,
-			(double)ctx->window_width/(double)ctx->window_height,
-			0.01f,
-			1000.0f);
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	gluLookAt(0.5, -0.5, 0.5,
-			0.0, 0.0, 0.0,
-			0.0, 0.0, 1.0);
-	glPushMatrix();
-
-	/* BEGIN: Drawing of 3d staff */
-
-	glBegin(GL_QUADS);
-		glNormal3f(1.0, 1.0, 1.0);
-		for(i = 0; i < ctx->nquads; i++) {
-			printf("q: %ld\n", i);
-			quad = &ctx->quads[4*i];
-			for(j = 0; j < 4; j++) {
-				if(j==3 && quad[3]==0) {
-					glVertex3dv(&ctx->vertices[quad[2]]);
-				} else {
-					printf("v (%ld): %6.3f, %6.3f, %6.3f\n",
-							quad[j],
-							ctx->vertices[quad[j] + 0],
-							ctx->vertices[quad[j] + 1],
-							ctx->vertices[quad[j] + 2]);
-					glVertex3dv(&ctx->vertices[quad[j]]);
-				}
-			}
-		}
-	glEnd();
+	uint64_t start = trace_begin();
 
-	/* END: Drawing of 3d staff */
-
-	glPopMatrix();
-	glMatrixMode(GL_MODELVIEW);
-	glPopMatrix();
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glMatrixMode(GL_MODELVIEW);
+	redraw = render_frame(&renderer, ctx->window_width, ctx->window_height);
 
 	glFlush();
 	glutSwapBuffers();
+
+	trace_end("frame", "render", start, (int64_t)renderer.stats.triangles);
 }
 
 /**
@@ -146,14 +73,89 @@ static void glut_on_display(void)
 static void glut_on_resize(int w, int h)
 {
 	ctx->window_width = w;
-	ctx->window_height = h;
+	ctx->window_height = (h > 0) ? h : 1;
+	redraw = 1;
+}
+
+/**
+ * Callback function called on mouse button press and release. Left button
+ * rotates camera, right button and wheel zoom camera.
+ */
+static void glut_on_mouse(int button, int state, int x, int y)
+{
+	/* Mouse wheel is reported as buttons 3 and 4 */
+	if(button == 3 || button == 4) {
+		if(state == GLUT_DOWN) {
+			renderer.camera.distance *= (button == 3) ? 0.9 : 1.0/0.9;
+			redraw = 1;
+		}
+		return;
+	}
+
+	mouse.button = (state == GLUT_DOWN) ? button : -1;
+	mouse.x = x;
+	mouse.y = y;
 }
 
 /**
- * \brief Display particles in regular periods
+ * Callback function called on mouse motion with pressed button
+ */
+static void glut_on_motion(int x, int y)
+{
+	struct Camera *camera = &renderer.camera;
+	int dx = x - mouse.x;
+	int dy = y - mouse.y;
+
+	if(mouse.button == GLUT_LEFT_BUTTON) {
+		camera->yaw += 0.5 * dx;
+		camera->pitch += 0.5 * dy;
+		if(camera->pitch > 0.0) camera->pitch = 0.0;
+		if(camera->pitch < -180.0) camera->pitch = -180.0;
+	} else if(mouse.button == GLUT_RIGHT_BUTTON) {
+		camera->distance *= pow(1.01, dy);
+	}
+
+	mouse.x = x;
+	mouse.y = y;
+	redraw = 1;
+}
+
+/**
+ * \brief This function shows progress of upload in title of window
+ */
+static void live_update_title(void)
+{
+	static uint64_t last_dropped = 0;
+	char title[128];
+	uint64_t dropped = atomic_load_explicit(&ctx->live_queue->dropped, memory_order_relaxed);
+
+	snprintf(title, sizeof(title), "PLY Loader (received: %lu, dropped: %lu, restored: %lu)",
+			(unsigned long)renderer.received, (unsigned long)dropped,
+			(unsigned long)renderer.restored);
+	glutSetWindowTitle(title);
+
+	if(dropped != last_dropped && ctx->print_debug) {
+		printf("%s(): preview queue is full, dropped items: %lu\n",
+				__func__, (unsigned long)dropped);
+	}
+	last_dropped = dropped;
+}
+
+/**
+ * \brief Redraw scene in regular periods, when it was changed. New data
+ * (octree or items received from server in live mode) are moved to buffer
+ * objects here.
  */
 static void glut_on_timer(int value) {
-	glutPostRedisplay();
+	if(render_update(&renderer) > 0) {
+		redraw = 1;
+	}
+	if(ctx->live_queue != NULL) {
+		live_update_title();
+	}
+	if(redraw == 1) {
+		glutPostRedisplay();
+	}
 	glutTimerFunc(40, glut_on_timer, value);
 }
 
@@ -170,8 +172,10 @@ static void glut_init(int argc, char *argv[])
 	glutCreateWindow("PLY Loader");
 	glutDisplayFunc(glut_on_display);
 	glutReshapeFunc(glut_on_resize);
+	glutMouseFunc(glut_on_mouse);
+	glutMotionFunc(glut_on_motion);
 	glutTimerFunc(40, glut_on_timer, 0);
-	gl_init();
+	render_init(&renderer, ctx);
 }
 
 /**
@@ -181,9 +185,10 @@ void *display_loop(void *arg)
 {
 	ctx = (struct CTX*) arg;
 
-	glut_init(ctx->argc, ctx->argv);
+	trace_thread_name("display");
 
 	if(ctx != NULL) {
+		glut_init(ctx->argc, ctx->argv);
 		glutMainLoop();
 	}
 
@@ -0,0 +1,349 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <verse.h>
+#include <rply.h>
+
+#include "main.h"
+#include "ply_props.h"
+#include "metrics.h"
+#include "download.h"
+
+/**
+ * @brief This function creates download of mesh node to PLY file
+ *
+ * @return Pointer at download or NULL on failure
+ */
+struct Download *download_create(uint32_t node_id, const char *filename, double idle_timeout)
+{
+	struct Download *download;
+
+	download = (struct Download*)calloc(1, sizeof(struct Download));
+	if(download == NULL) {
+		return NULL;
+	}
+
+	download->filename = strdup(filename);
+	if(download->filename == NULL) {
+		free(download);
+		return NULL;
+	}
+
+	download->node_id = node_id;
+	download->idle_timeout = (idle_timeout > 0.0) ? idle_timeout : DOWNLOAD_IDLE_TIMEOUT;
+	download->vertices.layer_id = -1;
+	download->faces.layer_id = -1;
+
+	return download;
+}
+
+/**
+ * @brief This function starts measuring of idle timeout. It is called,
+ * when client subscribes to the mesh node.
+ */
+void download_start(struct Download *download)
+{
+	download->last_time = metrics_now();
+}
+
+/**
+ * @brief This function checks layer created in the mesh node. Layers of
+ * vertices and faces have to be subscribed. Quantized vertices are not
+ * supported, because bounding box is stored in other node.
+ *
+ * @return 1, when layer has to be subscribed, 0 otherwise
+ */
+int download_layer_create(struct Download *download,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t custom_type)
+{
+	struct DownloadLayer *layer;
+
+	if(node_id != download->node_id) {
+		return 0;
+	}
+
+	download->activity++;
+
+	if(custom_type == LAYER_VERTEXES_CT) {
+		if(count != 3 || (data_type != VRS_VALUE_TYPE_REAL32 &&
+				data_type != VRS_VALUE_TYPE_REAL64)) {
+			printf("ERROR: Download of quantized vertices is not supported\n");
+			download->failed = 1;
+			return 0;
+		}
+		layer = &download->vertices;
+	} else if(custom_type == LAYER_QUADS_CT) {
+		if((count != 3 && count != 4) || (data_type != VRS_VALUE_TYPE_UINT32 &&
+				data_type != VRS_VALUE_TYPE_UINT64)) {
+			printf("ERROR: Unsupported type of layer of faces: %d x %d\n", data_type, count);
+			download->failed = 1;
+			return 0;
+		}
+		layer = &download->faces;
+	} else {
+		return 0;
+	}
+
+	if(layer->layer_id != -1) {
+		return 0;
+	}
+
+	layer->layer_id = layer_id;
+	layer->data_type = data_type;
+	layer->count = count;
+	layer->item_size = value_type_size(data_type) * count;
+
+	return 1;
+}
+
+/**
+ * @brief This function stores item received from server. Buffer of layer
+ * is reallocated only, when ID of item does not fit to it, and its
+ * capacity is doubled, so no memory is allocated for most of items.
+ */
+void download_store(struct Download *download,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value)
+{
+	struct DownloadLayer *layer;
+
+	if(node_id != download->node_id) {
+		return;
+	}
+
+	if(layer_id == download->vertices.layer_id) {
+		layer = &download->vertices;
+	} else if(layer_id == download->faces.layer_id) {
+		layer = &download->faces;
+	} else {
+		return;
+	}
+
+	if(data_type != layer->data_type || count != layer->count) {
+		return;
+	}
+
+	if(item_id >= layer->capacity) {
+		uint64_t capacity = (layer->capacity > 0) ? 2*layer->capacity : DOWNLOAD_INITIAL_ITEMS;
+		unsigned char *data;
+
+		while(capacity <= item_id) capacity *= 2;
+
+		data = (unsigned char*)realloc(layer->data, capacity * layer->item_size);
+		if(data == NULL) {
+			printf("ERROR: Out of memory\n");
+			download->failed = 1;
+			return;
+		}
+		memset(data + layer->capacity * layer->item_size, 0,
+				(capacity - layer->capacity) * layer->item_size);
+		layer->data = data;
+		layer->capacity = capacity;
+	}
+
+	memcpy(layer->data + (uint64_t)item_id * layer->item_size, value, layer->item_size);
+	if(item_id >= layer->nitems) {
+		layer->nitems = (uint64_t)item_id + 1;
+	}
+	layer->nreceived++;
+	download->activity++;
+}
+
+/**
+ * @brief This function returns 1, when no item was received during idle
+ * timeout or download failed. It is called from main loop of client, so
+ * clock is not read for each item. Timeout is not measured before
+ * download_start(), so slow connect or authentication is not counted.
+ */
+int download_idle(struct Download *download)
+{
+	uint64_t now;
+
+	if(download->failed == 1) {
+		return 1;
+	}
+
+	/* Node was not subscribed yet */
+	if(download->last_time == 0) {
+		return 0;
+	}
+
+	now = metrics_now();
+	if(download->activity != download->last_activity) {
+		download->last_activity = download->activity;
+		download->last_time = now;
+		return 0;
+	}
+
+	return ((now - download->last_time) * 1e-9 >= download->idle_timeout) ? 1 : 0;
+}
+
+/**
+ * @brief This function returns value of item of layer as double
+ */
+static double item_value(const struct DownloadLayer *layer, uint64_t item_id, int k)
+{
+	const unsigned char *item = layer->data + item_id * layer->item_size;
+
+	switch(layer->data_type) {
+	case VRS_VALUE_TYPE_REAL32:
+		{
+			float value;
+			memcpy(&value, item + k*sizeof(float), sizeof(float));
+			return value;
+		}
+	case VRS_VALUE_TYPE_REAL64:
+		{
+			double value;
+			memcpy(&value, item + k*sizeof(double), sizeof(double));
+			return value;
+		}
+	case VRS_VALUE_TYPE_UINT32:
+		{
+			uint32_t value;
+			memcpy(&value, item + k*sizeof(uint32_t), sizeof(uint32_t));
+			return value;
+		}
+	case VRS_VALUE_TYPE_UINT64:
+		{
+			uint64_t value;
+			memcpy(&value, item + k*sizeof(uint64_t), sizeof(uint64_t));
+			return (double)value;
+		}
+	default:
+		return 0.0;
+	}
+}
+
+/**
+ * @brief This function writes received vertices and faces to binary PLY
+ * file. Face with the last index equal to zero is triangle, like in
+ * faces uploaded by this client.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int download_write(struct Download *download)
+{
+	struct DownloadLayer *vertices = &download->vertices;
+	struct DownloadLayer *faces = &download->faces;
+	uint64_t i;
+	int k, ret = 1;
+	p_ply ply;
+
+	if(download->failed == 1) {
+		return 0;
+	}
+
+	if(vertices->layer_id == -1) {
+		printf("ERROR: Node %u does not contain layer of vertices\n", download->node_id);
+		return 0;
+	}
+
+	if(vertices->nreceived != vertices->nitems || faces->nreceived != faces->nitems) {
+		printf("WARNING: Some items were not received, vertices: %lu/%lu, faces: %lu/%lu\n",
+				(unsigned long)vertices->nreceived, (unsigned long)vertices->nitems,
+				(unsigned long)faces->nreceived, (unsigned long)faces->nitems);
+	}
+
+	ply = ply_create(download->filename, PLY_LITTLE_ENDIAN, NULL, 0, NULL);
+	if(ply == NULL) {
+		printf("ERROR: Unable to create PLY file: %s\n", download->filename);
+		return 0;
+	}
+
+	ply_add_comment(ply, "mesh downloaded from Verse server");
+
+	ply_add_element(ply, "vertex", (long)vertices->nitems);
+	for(k = 0; k < 3; k++) {
+		static const char *names[3] = {"x", "y", "z"};
+		ply_add_scalar_property(ply, names[k],
+				(vertices->data_type == VRS_VALUE_TYPE_REAL32) ? PLY_FLOAT : PLY_DOUBLE);
+	}
+
+	ply_add_element(ply, "face", (long)faces->nitems);
+	ply_add_list_property(ply, "vertex_indices", PLY_UCHAR, PLY_UINT);
+
+	if(!ply_write_header(ply)) {
+		printf("ERROR: Unable to write header of PLY file: %s\n", download->filename);
+		ply_close(ply);
+		return 0;
+	}
+
+	for(i = 0; i < vertices->nitems && ret == 1; i++) {
+		for(k = 0; k < 3; k++) {
+			ret &= ply_write(ply, item_value(vertices, i, k)) ? 1 : 0;
+		}
+	}
+
+	for(i = 0; i < faces->nitems && ret == 1; i++) {
+		int arity = faces->count;
+
+		/* Triangles are stored with the fourth index equal to zero. The
+		 * loader rotates quads ending with vertex 0, so uploaded quads
+		 * never end with zero. */
+		if(arity == 4 && item_value(faces, i, 3) == 0.0) {
+			arity = 3;
+		}
+		ret &= ply_write(ply, arity) ? 1 : 0;
+		for(k = 0; k < arity; k++) {
+			ret &= ply_write(ply, item_value(faces, i, k)) ? 1 : 0;
+		}
+	}
+
+	if(!ply_close(ply) || ret != 1) {
+		printf("ERROR: Unable to write PLY file: %s\n", download->filename);
+		return 0;
+	}
+
+	printf("download: vertices: %lu, faces: %lu, file: %s\n",
+			(unsigned long)vertices->nitems, (unsigned long)faces->nitems,
+			download->filename);
+
+	return 1;
+}
+
+/**
+ * @brief This function frees received items
+ */
+void download_destroy(struct Download *download)
+{
+	if(download == NULL) return;
+
+	free(download->vertices.data);
+	free(download->faces.data);
+	free(download->filename);
+	free(download);
+}
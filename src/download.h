@@ -0,0 +1,104 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef DOWNLOAD_H_
+#define DOWNLOAD_H_
+
+/* Default time without received items, when download is finished (seconds) */
+#define DOWNLOAD_IDLE_TIMEOUT 2.0
+
+/* Initial number of items of buffer of downloaded layer */
+#define DOWNLOAD_INITIAL_ITEMS 4096
+
+/**
+ * Layer of mesh node received from server. Items are stored at index of
+ * their ID in buffer, which grows geometrically.
+ */
+typedef struct DownloadLayer {
+	/* ID of layer or -1, when layer was not created yet */
+	int64_t layer_id;
+	uint8_t data_type;
+	uint8_t count;
+	size_t item_size;
+	/* Items indexed by ID of item */
+	unsigned char *data;
+	/* Number of items fitting to data */
+	uint64_t capacity;
+	/* Maximal received ID of item + 1 */
+	uint64_t nitems;
+	/* Number of received items */
+	uint64_t nreceived;
+} DownloadLayer;
+
+/**
+ * Download of existing mesh node to PLY file
+ */
+typedef struct Download {
+	/* ID of downloaded mesh node */
+	uint32_t node_id;
+	/* Output PLY file */
+	char *filename;
+	/* Time without received items, when download is finished (seconds) */
+	double idle_timeout;
+	struct DownloadLayer vertices;
+	struct DownloadLayer faces;
+	/* Number of received commands related to downloaded node */
+	uint64_t activity;
+	/* Value of activity and time (ns), when it was checked last time */
+	uint64_t last_activity;
+	uint64_t last_time;
+	/* Flag of download, which can not be finished */
+	int failed;
+} Download;
+
+struct Download *download_create(uint32_t node_id, const char *filename, double idle_timeout);
+
+void download_start(struct Download *download);
+
+int download_layer_create(struct Download *download,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t custom_type);
+
+void download_store(struct Download *download,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value);
+
+int download_idle(struct Download *download);
+
+int download_write(struct Download *download);
+
+void download_destroy(struct Download *download);
+
+#endif /* DOWNLOAD_H_ */
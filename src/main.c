@@ -27,53 +27,42 @@
 #include <verse.h>
 #include <rply.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <string.h>
 #include <signal.h>
 
 #include "main.h"
+#include "render.h"
 #include "display_glut.h"
+#include "uploader.h"
+#include "trace.h"
+#include "download.h"
+#include "meshlet.h"
+#include "quantize.h"
+
+/* Long options without short equivalent */
+#define OPT_TRACE	256
+#define OPT_VERIFY	257
+#define OPT_DOWNLOAD	258
+#define OPT_OUTPUT	259
+#define OPT_IDLE_TIMEOUT	260
+#define OPT_MESHLETS	261
+#define OPT_CHECK_ONLY	262
+#define OPT_REPAIR	263
 
 static struct CTX *ctx = NULL;
 
-/**
- * @brief This function initialize context of client
- *
- * @param ctx
- */
-void init_CTX(struct CTX *_ctx)
-{
-	_ctx->my_filename = NULL;
-	_ctx->print_debug = 0;
-	_ctx->my_session_id = -1;
-	_ctx->my_username  = NULL;
-	_ctx->my_password  = NULL;
-	_ctx->my_verse_server = NULL;
-	_ctx->my_user_id = -1;
-	_ctx->my_avatar_id = -1;
-	_ctx->my_object_node_id  = -1;
-	_ctx->my_mesh_node_id  = -1;
-	_ctx->my_vertex_layer_id  = -1;
-	_ctx->my_face_layer_id = -1;
-	_ctx->nvertices = 0;
-	_ctx->vertices = NULL;
-	_ctx->nquads = 0;
-	_ctx->quads = NULL;
-}
-
-/**
- * @brief This function clear client context
- *
- * @param _ctx
- */
-void clear_CTX(struct CTX *_ctx)
-{
-	if(_ctx->my_filename != NULL) free(_ctx->my_filename);
-	if(_ctx->my_username != NULL) free(_ctx->my_username);
-	if(_ctx->my_password != NULL) free(_ctx->my_password);
-	if(_ctx->my_verse_server != NULL) free(_ctx->my_verse_server);
-	if(_ctx->vertices != NULL) free(_ctx->vertices);
-	if(_ctx->quads != NULL) free(_ctx->quads);
-}
+static const struct option long_options[] = {
+	{"trace", required_argument, NULL, OPT_TRACE},
+	{"verify", no_argument, NULL, OPT_VERIFY},
+	{"download", required_argument, NULL, OPT_DOWNLOAD},
+	{"output", required_argument, NULL, OPT_OUTPUT},
+	{"idle-timeout", required_argument, NULL, OPT_IDLE_TIMEOUT},
+	{"meshlets", no_argument, NULL, OPT_MESHLETS},
+	{"check-only", no_argument, NULL, OPT_CHECK_ONLY},
+	{"repair", no_argument, NULL, OPT_REPAIR},
+	{NULL, 0, NULL, 0}
+};
 
 /**
 * \brief Callback function for handling signals.
@@ -93,450 +82,14 @@ static void handle_signal(int sig)
 	}
 }
 
-/**
- *
- * @param argument
- * @return
- */
-static int vertex_cb(p_ply_argument argument)
-{
-	long xyz, *vert_num;
-	ply_get_argument_user_data(argument, (void**)&vert_num, &xyz);
-	switch(xyz) {
-	case 0:
-		/* printf("%ld ", *vert_num); */
-		ctx->vertices[3*(*vert_num) + 0] = ply_get_argument_value(argument);
-		break;
-	case 1:
-		ctx->vertices[3*(*vert_num) + 1] = ply_get_argument_value(argument);
-		break;
-	case 2:
-		ctx->vertices[3*(*vert_num) + 2] = ply_get_argument_value(argument);
-		printf("(%g, %g, %g)\n",
-				ctx->vertices[3*(*vert_num) + 0],
-				ctx->vertices[3*(*vert_num) + 1],
-				ctx->vertices[3*(*vert_num) + 2]);
-		*vert_num = *vert_num + 1;
-		break;
-	}
-	return 1;
-}
-
-/**
- *
- * @param argument
- * @return
- */
-static int face_cb(p_ply_argument argument)
-{
-	long length, value_index, *face_num;
-	static int size;
-	static long face_size = 0;
-
-	ply_get_argument_user_data(argument, (void**)&face_num, NULL);
-	ply_get_argument_property(argument, NULL, &length, &value_index);
-
-	/* When first index is loaded */
-	if(value_index == 0) {
-		face_size = length;
-		size = (face_size < 4) ? 4 : face_size;
-		printf("%ld, %ld, ", *face_num, length);
-	}
-
-	if(value_index < 4) {
-		ctx->quads[4*(*face_num) + value_index] = (long)ply_get_argument_value(argument);
-	}
-
-	/* When last face index is loaded */
-	if(value_index >= 0 && value_index == (face_size - 1)) {
-		long i;
-		printf("{");
-		for(i = 0; i < size; i++) {
-			if(i != (size - 1)) {
-				printf("%ld, ", ctx->quads[4*(*face_num) + i]);
-			} else {
-				printf("%ld", ctx->quads[4*(*face_num) + i]);
-			}
-		}
-		printf("}\n");
-
-		*face_num = *face_num + 1;
-	}
-
-	return 1;
-}
-
-
-static void upload_mesh(void)
-{
-	uint64_t vert_id, quad_id;
-
-	for(vert_id = 0; vert_id < ctx->nvertices; vert_id++ ) {
-		vrs_send_layer_set_value(ctx->my_session_id,
-				VRS_DEFAULT_PRIORITY,
-				ctx->my_mesh_node_id,
-				ctx->my_vertex_layer_id,
-				vert_id,
-				VRS_VALUE_TYPE_REAL64,
-				3,
-				(void*)&ctx->vertices[3*vert_id]);
-	}
-
-	for(quad_id = 0; quad_id < ctx->nquads; quad_id++) {
-		vrs_send_layer_set_value(ctx->my_session_id,
-				VRS_DEFAULT_PRIORITY,
-				ctx->my_mesh_node_id,
-				ctx->my_face_layer_id,
-				quad_id,
-				VRS_VALUE_TYPE_UINT64,
-				4,
-				(void*)&ctx->quads[4*quad_id]);
-	}
-}
-
-
-/**
- * @brief The callback function or command layer set_value
- *
- * @param session_id
- * @param node_id
- * @param layer_id
- * @param item_id
- * @param data_type
- * @param count
- * @param value
- */
-static void cb_receive_layer_set_value(const uint8_t session_id,
-	     const uint32_t node_id,
-	     const uint16_t layer_id,
-	     const uint32_t item_id,
-	     const uint8_t data_type,
-	     const uint8_t count,
-	     const void *value)
-{
-	int i;
-
-	if(ctx->print_debug) {
-		printf("%s(): session_id: %u, node_id: %u, layer_id: %d, item_id: %d, data_type: %d, count: %d, value(s): ",
-				__FUNCTION__, session_id, node_id, layer_id, item_id, data_type, count);
-
-		switch(data_type) {
-		case VRS_VALUE_TYPE_UINT8:
-			for(i=0; i<count; i++) {
-				printf("%d, ", ((uint8_t*)value)[i]);
-			}
-			break;
-		case VRS_VALUE_TYPE_UINT16:
-			for(i=0; i<count; i++) {
-				printf("%d, ", ((uint16_t*)value)[i]);
-			}
-			break;
-		case VRS_VALUE_TYPE_UINT32:
-			for(i=0; i<count; i++) {
-				printf("%d, ", ((uint32_t*)value)[i]);
-			}
-			break;
-		case VRS_VALUE_TYPE_UINT64:
-			for(i=0; i<count; i++) {
-#ifdef __APPLE__
-				printf("%llu, ", ((uint64_t*)value)[i]);
-#else
-				printf("%lu, ", ((uint64_t*)value)[i]);
-#endif
-			}
-			break;
-		case VRS_VALUE_TYPE_REAL16:
-			for(i=0; i<count; i++) {
-				/* TODO: convert half-float to float and print it as float value */
-				printf("%x, ", ((uint16_t*)value)[i]);
-			}
-			break;
-		case VRS_VALUE_TYPE_REAL32:
-			for(i=0; i<count; i++) {
-				printf("%6.3f, ", ((float*)value)[i]);
-			}
-			break;
-		case VRS_VALUE_TYPE_REAL64:
-			for(i=0; i<count; i++) {
-				printf("%6.3f, ", ((double*)value)[i]);
-			}
-			break;
-		default:
-			printf("Unknown type");
-			break;
-		}
-		printf("\n");
-	}
-}
-
-/**
- * @brief The callback function or command layer create
- *
- * @param session_id
- * @param node_id
- * @param parent_layer_id
- * @param layer_id
- * @param data_type
- * @param count
- * @param custom_type
- */
-static void cb_receive_layer_create(const uint8_t session_id,
-		const uint32_t node_id,
-		const uint16_t parent_layer_id,
-		const uint16_t layer_id,
-		const uint8_t data_type,
-		const uint8_t count,
-		const uint16_t custom_type)
-{
-	if(ctx->print_debug) {
-		printf("%s(): session_id: %u, node_id: %u, parent_layer_id: %d, layer_id: %d, data_type: %d, count: %d, custom_type: %d\n",
-			__FUNCTION__, session_id, node_id, parent_layer_id, layer_id, data_type, count, custom_type);
-	}
-
-	if(node_id == ctx->my_mesh_node_id && custom_type == LAYER_VERTEXES_CT) {
-		vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
-		ctx->my_vertex_layer_id = layer_id;
-	}
-
-	if(node_id == ctx->my_mesh_node_id && custom_type == LAYER_QUADS_CT) {
-		vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
-		ctx->my_face_layer_id = layer_id;
-	}
-
-	if(ctx->my_vertex_layer_id != -1 && ctx->my_face_layer_id != -1) {
-		/* Start to upload vertices and faces to Verse server */
-		upload_mesh();
-	}
-}
-
-/**
- *
- * @param session_id
- * @param node_id
- * @param parent_id
- * @param user_id
- * @param custom_type
- */
-static void cb_receive_node_create(const uint8_t session_id,
-		const uint32_t node_id,
-		const uint32_t parent_id,
-		const uint16_t user_id,
-		const uint16_t custom_type)
-{
-	if(ctx->print_debug) {
-		printf("%s() session_id: %d, node_id: %d, parent_id: %d, user_id: %d, custom_type: %d\n",
-			__FUNCTION__, session_id, node_id, parent_id, user_id, custom_type);
-	}
-
-	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, 0, 0);
-
-	if(parent_id == ctx->my_avatar_id && custom_type == OBJECT_NODE_CT) {
-		ctx->my_object_node_id = node_id;
-		vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, VRS_SCENE_PARENT_NODE_ID, node_id);
-		if(ctx->my_mesh_node_id != -1) {
-			vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, ctx->my_object_node_id, node_id);
-		}
-	}
-
-	if(parent_id == ctx->my_avatar_id && custom_type == MESH_NODE_CT) {
-		ctx->my_mesh_node_id = node_id;
-		if(ctx->my_object_node_id != -1) {
-			vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, ctx->my_object_node_id, node_id);
-		}
-		vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_REAL64, 3, LAYER_VERTEXES_CT);
-		vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_UINT64, 2, LAYER_EDGES_CT);
-		vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_UINT64, 4, LAYER_QUADS_CT);
-	}
-}
-
-/**
- * @brief Callback function for user authentication
- *
- * @param session_id
- * @param username
- * @param auth_methods_count
- * @param methods
- */
-static void cb_receive_user_authenticate(const uint8_t session_id,
-		const char *username,
-		const uint8_t auth_methods_count,
-		const uint8_t *methods)
-{
-	static int attempts = 0;	/* Store number of authentication attempt for this session. */
-	char name[VRS_MAX_USERNAME_LENGTH + 1];
-	char *password;
-	int i, is_passwd_supported = 0;
-
-	/* Debug print */
-	if(ctx->print_debug) {
-		printf("%s() username: %s, auth_methods_count: %d, methods: ",
-				__FUNCTION__, username, auth_methods_count);
-		for(i = 0; i < auth_methods_count; i++) {
-			printf("%d, ", methods[i]);
-		}
-		printf("\n");
-	}
-
-	for(i = 0; i < auth_methods_count; i++) {
-		if(methods[i] == VRS_UA_METHOD_PASSWORD) {
-			is_passwd_supported = 1;
-		}
-	}
-
-	/* Get username, when it is requested */
-	if(username == NULL) {
-		int ret = 0;
-		attempts = 0;	/* Reset counter of auth. attempt. */
-		if(ctx->my_username != NULL) {
-			vrs_send_user_authenticate(session_id, ctx->my_username, 0, NULL);
-		} else {
-			printf("Username: ");
-			ret = scanf("%s", name);
-			if(ret == 1) {
-				vrs_send_user_authenticate(session_id, name, 0, NULL);
-			} else {
-				printf("ERROR: Reading username.\n");
-				exit(EXIT_FAILURE);
-			}
-		}
-	} else {
-		if(is_passwd_supported == 1) {
-			attempts++;
-			strncpy(name, username, VRS_MAX_USERNAME_LENGTH);
-			if(ctx->my_password != NULL && attempts == 1) {
-				vrs_send_user_authenticate(session_id, name,
-						VRS_UA_METHOD_PASSWORD, ctx->my_password);
-			} else {
-				/* Print this warning, when previous authentication attempt failed. */
-				if(attempts > 1)
-					printf("Permission denied, please try again.\n");
-				/* Get password from user */
-				password = getpass("Password: ");
-				vrs_send_user_authenticate(session_id, name, VRS_UA_METHOD_PASSWORD, password);
-			}
-		} else {
-			printf("ERROR: Verse server does not support password authentication method\n");
-		}
-	}
-}
-
-/**
- * @brief Callback function for connect accept
- *
- * @param session_id
- * @param user_id
- * @param avatar_id
- */
-static void cb_receive_connect_accept(const uint8_t session_id,
-		const uint16_t user_id,
-		const uint32_t avatar_id)
-{
-	if(ctx->print_debug) {
-		printf("%s() session_id: %d, user_id: %d, avatar_id: %d\n",
-			__FUNCTION__, session_id, user_id, avatar_id);
-	}
-
-	ctx->my_avatar_id = avatar_id;
-	ctx->my_user_id = user_id;
-
-	/* When client receive connect accept, then it is ready to subscribe
-	 * to the root node of the node tree. Id of root node is still 0. This
-	 * function is called with level 1. It means, that this client will be
-	 * subscribed to the root node and its child nodes (1, 2, 3) */
-	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, 0, 0, 0);
-
-	/* Check if server allow double subscribe? */
-	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, 1, 0, 0);
-
-	/* Try to create new nodes */
-	vrs_send_node_create(session_id, VRS_DEFAULT_PRIORITY, OBJECT_NODE_CT);
-	vrs_send_node_create(session_id, VRS_DEFAULT_PRIORITY, MESH_NODE_CT);
-}
-
-/**
- * @brief Callback function for connect terminate
- *
- * @param session_id
- * @param error_num
- */
-static void cb_receive_connect_terminate(const uint8_t session_id,
-		const uint8_t error_num)
-{
-	if(ctx->print_debug) {
-		printf("%s() session_id: %d, error_num: %d\n",
-			__FUNCTION__, session_id, error_num);
-		switch(error_num) {
-		case VRS_CONN_TERM_AUTH_FAILED:
-			printf("User authentication failed\n");
-			break;
-		case VRS_CONN_TERM_HOST_DOWN:
-			printf("Host is not accessible\n");
-			break;
-		case VRS_CONN_TERM_HOST_UNKNOWN:
-			printf("Host could not be found\n");
-			break;
-		case VRS_CONN_TERM_SERVER_DOWN:
-			printf("Server is not running\n");
-			break;
-		case VRS_CONN_TERM_TIMEOUT:
-			printf("Connection timeout\n");
-			break;
-		case VRS_CONN_TERM_ERROR:
-			printf("Connection with server was broken\n");
-			break;
-		case VRS_CONN_TERM_SERVER:
-			printf("Connection was terminated by server\n");
-			break;
-		case VRS_CONN_TERM_CLIENT:
-			printf("Connection was terminated by client\n");
-			break;
-		default:
-			printf("Unknown error\n");
-			break;
-		}
-	}
-	exit(EXIT_SUCCESS);
-}
-
-/**
- * @brief Load vertices and faces to the memory
- */
-static void load_ply_file(char *my_filename)
-{
-	long vert_num = 0, face_num = 0;
-	p_ply ply;
-
-	ply = ply_open(my_filename, NULL, 0, NULL);
-
-	if (!ply) return;
-
-	if (!ply_read_header(ply)) return;
-
-	ctx->nvertices = ply_set_read_cb(ply, "vertex", "x", vertex_cb, &vert_num, 0);
-	ply_set_read_cb(ply, "vertex", "y", vertex_cb, &vert_num, 1);
-	ply_set_read_cb(ply, "vertex", "z", vertex_cb, &vert_num, 2);
-	ctx->nquads = ply_set_read_cb(ply, "face", "vertex_indices", face_cb, &face_num, 0);
-
-	/* Allocate memory for vertices */
-	ctx->vertices = (double*)calloc(3*ctx->nvertices, sizeof(double));
-
-	/* Allocate memory for face indexes */
-	ctx->quads = (uint64_t*)calloc(4*ctx->nquads, sizeof(uint64_t));
-
-	printf("vertices: %ld, faces: %ld\n", ctx->nvertices, ctx->nquads);
-
-	/* Load whole file to memory */
-	if (!ply_read(ply)) return;
-
-	ply_close(ply);
-}
-
 /**
  * @brief Print help
  */
 static void print_help(char *prog_name)
 {
 	printf("\n Usage: %s -f filename server_address\n", prog_name);
+	printf("        %s --check-only -f filename\n", prog_name);
+	printf("        %s --download node_id --output filename server_address\n", prog_name);
 	printf("\n");
 	printf(" This program is Verse client uploading PLY model to \n");
 	printf(" to Verse server.\n");
@@ -544,8 +97,62 @@ static void print_help(char *prog_name)
 	printf(" Options:\n");
 	printf(" -f filename       Filename of PLY file.\n");
 	printf(" -d                Print debug prints.\n");
+	printf(" -e                Exit, when all items of mesh were received\n");
+	printf("                   back from server.\n");
+#if WITH_GLUT
+	printf(" -g                Show preview of mesh in window.\n");
+	printf(" -l                Show mesh received from server in preview\n");
+	printf("                   window to watch progress of upload.\n");
+	printf(" -b triangles      Maximal number of triangles drawn in one frame\n");
+	printf("                   of preview (default: %d).\n", RENDER_TRIANGLE_BUDGET);
+#endif
 	printf(" -u username       Username used for authentication.\n");
 	printf(" -p password       Password used for authentication.\n");
+	printf(" -c                Move center of bounding box to the origin.\n");
+	printf(" -s scale          Uniform scale of mesh (e.g. 0.001 for mm to m).\n");
+	printf(" -a axes           Permutation of axes (e.g. x-zy for Y-up to Z-up).\n");
+	printf(" -m matrix         Row-major 4x4 matrix of 16 comma separated values.\n");
+	printf("                   Transformations are applied in this order:\n");
+	printf("                   recenter, axes, scale, matrix.\n");
+	printf(" -q bits           Upload vertices quantized relative to bounding\n");
+	printf("                   box with given number of bits (1 - 21).\n");
+	printf(" --check-only      Only load and validate PLY file (indices, non-finite\n");
+	printf("                   coordinates, degenerate faces) and exit without\n");
+	printf("                   connecting to server.\n");
+	printf(" --repair          Remove invalid and degenerate faces and reset\n");
+	printf("                   non-finite coordinates instead of failing.\n");
+	printf(" --meshlets        Reorder faces to meshlets (at most %d vertices\n", MESHLET_MAX_VERTICES);
+	printf("                   and %d triangles) and upload their bounding\n", MESHLET_MAX_TRIANGLES);
+	printf("                   spheres and normal cones as extra layers.\n");
+	printf(" -N                Do not compute vertex normals, when PLY file\n");
+	printf("                   does not contain them.\n");
+	printf(" -t threads        Number of threads used for processing of mesh.\n");
+	printf(" -P props          Comma separated list of extra vertex properties\n");
+	printf("                   (e.g. normal,color,uv,confidence) uploaded to\n");
+	printf("                   the server. All properties are uploaded by default.\n");
+	printf("                   Normals are computed only, when \"normal\" is\n");
+	printf("                   selected. Use \"none\" to upload only vertices\n");
+	printf("                   and faces.\n");
+	printf(" -M path           Write metrics of loading and upload periodically\n");
+	printf("                   to file or to UNIX socket (%spath).\n", METRICS_UNIX_PREFIX);
+	printf(" -F format         Format of metrics: prometheus or json\n");
+	printf("                   (default: prometheus).\n");
+	printf(" -i interval       Interval of writing of metrics in seconds\n");
+	printf("                   (default: %g).\n", METRICS_INTERVAL);
+	printf(" --trace filename  Write timeline of loading and upload in Chrome\n");
+	printf("                   trace event format (chrome://tracing, Perfetto).\n");
+	printf(" --verify          Compare mesh received back from server with uploaded\n");
+	printf("                   (transformed, quantized) mesh using checksums of\n");
+	printf("                   blocks of items and exit.\n");
+	printf(" --download node_id\n");
+	printf("                   Write existing mesh node to binary PLY file\n");
+	printf("                   instead of upload (quantized vertices are not\n");
+	printf("                   supported).\n");
+	printf(" --output filename PLY file written by --download.\n");
+	printf(" --idle-timeout seconds\n");
+	printf("                   Finish download or fail verification, when\n");
+	printf("                   no item was received for given time\n");
+	printf("                   (default: %g).\n", DOWNLOAD_IDLE_TIMEOUT);
 	printf("\n");
 }
 
@@ -558,18 +165,24 @@ static void print_help(char *prog_name)
  */
 int main(int argc, char *argv[])
 {
-	int error_num, opt;
-	unsigned short flags = VRS_SEC_DATA_NONE;
+	const char *trace_filename = NULL;
+	const char *output_filename = NULL;
+	int64_t download_node_id = -1;
+	char *end;
+	long bits;
+	int opt;
 
 	ctx = (struct CTX*)calloc(1, sizeof(CTX));
 	if(ctx == NULL) {
 		printf("Out of memory\n");
 		exit(EXIT_FAILURE);
 	}
+	init_CTX(ctx);
 
 	if(argc > 0) {
 		/* Parse all options */
-		while( (opt = getopt(argc, argv, "f:hdu:p:")) != -1) {
+		while( (opt = getopt_long(argc, argv, "f:hdeglb:u:p:P:Nt:q:cs:a:m:M:F:i:",
+				long_options, NULL)) != -1) {
 			switch(opt) {
 			case 'f':
 				ctx->my_filename = strdup(optarg);
@@ -582,18 +195,107 @@ int main(int argc, char *argv[])
 			case 'd':
 				ctx->print_debug = 1;
 				break;
+			case 'e':
+				ctx->exit_after_upload = 1;
+				break;
+			case 'g':
+				ctx->display = 1;
+				break;
+			case 'l':
+				ctx->display = 1;
+				ctx->display_live = 1;
+				break;
+			case 'b':
+				ctx->display_budget = strtoull(optarg, NULL, 10);
+				break;
 			case 'u':
 				ctx->my_username = strdup(optarg);
 				break;
 			case 'p':
 				ctx->my_password = strdup(optarg);
 				break;
+			case 'P':
+				ctx->my_props = strdup(optarg);
+				break;
+			case 'N':
+				ctx->compute_normals = 0;
+				break;
+			case 't':
+				ctx->nthreads = atoi(optarg);
+				break;
+			case 'q':
+				bits = strtol(optarg, &end, 10);
+				if(end == optarg || *end != '\0' || bits < 1 || bits > QUANT_MAX_BITS) {
+					printf("ERROR: Number of bits of quantization has to be 1 - %d: %s\n",
+							QUANT_MAX_BITS, optarg);
+					exit(EXIT_FAILURE);
+				}
+				ctx->quant_bits = (int)bits;
+				break;
+			case 'c':
+				ctx->recenter = 1;
+				break;
+			case 's':
+				ctx->scale = atof(optarg);
+				if(ctx->scale == 0.0) {
+					printf("ERROR: Scale has to be nonzero number\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'a':
+				ctx->my_axes = strdup(optarg);
+				break;
+			case 'm':
+				ctx->my_matrix = strdup(optarg);
+				break;
+			case 'M':
+				ctx->metrics.path = strdup(optarg);
+				break;
+			case 'F':
+				ctx->metrics.format = metrics_parse_format(optarg);
+				if(ctx->metrics.format == -1) {
+					printf("ERROR: Unknown format of metrics: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'i':
+				ctx->metrics.interval = atof(optarg);
+				break;
+			case OPT_TRACE:
+				trace_filename = optarg;
+				break;
+			case OPT_VERIFY:
+				ctx->verify = 1;
+				ctx->exit_after_upload = 1;
+				break;
+			case OPT_DOWNLOAD:
+				download_node_id = strtoll(optarg, NULL, 10);
+				break;
+			case OPT_OUTPUT:
+				output_filename = optarg;
+				break;
+			case OPT_IDLE_TIMEOUT:
+				ctx->idle_timeout = strtod(optarg, &end);
+				if(end == optarg || *end != '\0' || !(ctx->idle_timeout > 0.0)) {
+					printf("ERROR: Bad idle timeout: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case OPT_MESHLETS:
+				ctx->meshlets = 1;
+				break;
+			case OPT_CHECK_ONLY:
+				ctx->check_only = 1;
+				break;
+			case OPT_REPAIR:
+				ctx->repair = 1;
+				break;
 			case '?':
 				exit(EXIT_FAILURE);
 			}
 		}
 		/* The last argument has to be name of server  */
-		if( (optind + 1) != argc) {
+		if( (optind + 1) != argc && (ctx->check_only == 0 || optind != argc)) {
 			printf("ERROR: Bad number of parameters: %d != 1\n", argc - optind);
 			print_help(argv[0]);
 			return EXIT_FAILURE;
@@ -604,14 +306,58 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	/* Load PLY file to memory */
-	if(ctx->my_filename != NULL) {
-		load_ply_file(ctx->my_filename);
-	} else {
+	/* Mesh node is downloaded to PLY file instead of upload */
+	if(download_node_id != -1 && ctx->check_only == 0) {
+		if(download_node_id < 0 || download_node_id > UINT32_MAX || output_filename == NULL) {
+			printf("ERROR: Download requires ID of node and output filename\n");
+			print_help(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		ctx->download = download_create((uint32_t)download_node_id, output_filename, ctx->idle_timeout);
+		if(ctx->download == NULL) {
+			printf("ERROR: Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* PLY file is required */
+	if(ctx->my_filename == NULL && ctx->download == NULL) {
 		print_help(argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
+	/* Start recording of trace events, they are written at exit */
+	if(trace_filename != NULL) {
+		if(trace_init(trace_filename) != 1) {
+			printf("ERROR: Unable to start tracing to file: %s\n", trace_filename);
+			clear_CTX(ctx);
+			free(ctx);
+			exit(EXIT_FAILURE);
+		}
+		trace_thread_name("main");
+	}
+
+	/* Start writer of metrics */
+	if(metrics_start(&ctx->metrics) != 1) {
+		clear_CTX(ctx);
+		free(ctx);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Load, validate, transform, compute normals and quantize mesh */
+	if(ctx->download == NULL && prepare_mesh(ctx) != 1) {
+		clear_CTX(ctx);
+		free(ctx);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Mesh is valid, nothing is sent to server */
+	if(ctx->check_only == 1) {
+		clear_CTX(ctx);
+		free(ctx);
+		return EXIT_SUCCESS;
+	}
+
 	/* Set up server name */
 	ctx->my_verse_server = strdup(argv[optind]);
 
@@ -620,47 +366,38 @@ int main(int argc, char *argv[])
 
 #if WITH_GLUT
 	/* Try to display PLY file */
-/*
-	if( pthread_create(&ctx->glut_thread, NULL, display_loop, (void*)ctx) != 0) {
-		clear_CTX(ctx);
-		exit(EXIT_FAILURE);
+	if(ctx->display == 1) {
+		if(ctx->display_live == 1 && render_live_init(ctx) != 1) {
+			printf("ERROR: Out of memory\n");
+			clear_CTX(ctx);
+			free(ctx);
+			exit(EXIT_FAILURE);
+		}
+		if( pthread_create(&ctx->glut_thread, NULL, display_loop, (void*)ctx) != 0) {
+			clear_CTX(ctx);
+			free(ctx);
+			exit(EXIT_FAILURE);
+		}
 	}
-*/
 #endif
 
-/*
-	while(1) {
-		sleep(1);
-	}
-*/
-
 	/* Handle SIGINT signal. The handle_signal function will try to terminate
 	 * connection. */
 	signal(SIGINT, handle_signal);
 
-	/* Register basic callback functions */
-	vrs_register_receive_user_authenticate(cb_receive_user_authenticate);
-	vrs_register_receive_connect_accept(cb_receive_connect_accept);
-	vrs_register_receive_connect_terminate(cb_receive_connect_terminate);
-
-	vrs_register_receive_node_create(cb_receive_node_create);
-	vrs_register_receive_layer_create(cb_receive_layer_create);
-	vrs_register_receive_layer_set_value(cb_receive_layer_set_value);
-
-	/* Send connect request to the server */
-	error_num = vrs_send_connect_request(ctx->my_verse_server, "12345", flags, &ctx->my_session_id);
-	if(error_num != VRS_SUCCESS) {
-		printf("ERROR: %s\n", vrs_strerror(error_num));
+	/* Connect to server and upload mesh */
+	if(uploader_session(ctx) != 1) {
+		metrics_stop(&ctx->metrics);
 		return EXIT_FAILURE;
 	}
 
-	/* Never ending loop */
-	while(1) {
-		vrs_callback_update(ctx->my_session_id);
-		usleep(1000000/FPS);
+#if WITH_GLUT
+	/* Preview window is closed with the end of process */
+	if(ctx->display == 1) {
+		metrics_stop(&ctx->metrics);
+		exit(EXIT_SUCCESS);
 	}
-
-	/* TODO: pthread join */
+#endif
 
 	clear_CTX(ctx);
 	free(ctx);
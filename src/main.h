@@ -24,6 +24,9 @@
 
 #include <pthread.h>
 
+#include "mesh.h"
+#include "metrics.h"
+
 #ifndef MAIN_H_
 #define MAIN_H_
 
@@ -42,6 +45,43 @@
 #define LAYER_EDGES_CT    1
 /* Custom type of layer containing faces */
 #define LAYER_QUADS_CT    2
+/* Custom type of layer containing vertex normals */
+#define LAYER_NORMALS_CT    3
+/* Custom type of layer containing vertex colors */
+#define LAYER_COLORS_CT     4
+/* Custom type of layer containing texture coordinates */
+#define LAYER_UVS_CT        5
+/* Custom type of layer containing confidence of scanner */
+#define LAYER_CONFIDENCE_CT 6
+/* Custom type of layer containing intensity of scanner */
+#define LAYER_INTENSITY_CT  7
+/* Custom type of layer containing ranges of faces of meshlets (UINT32 x3) */
+#define LAYER_MESHLETS_CT   8
+/* Custom type of layer containing bounding spheres of meshlets (REAL32 x4) */
+#define LAYER_MESHLET_SPHERES_CT 9
+/* Custom type of layer containing normal cones of meshlets (REAL32 x4) */
+#define LAYER_MESHLET_CONES_CT   10
+/* First custom type of layers containing other vertex properties */
+#define LAYER_PROPERTY_CT   16
+
+/* Custom type of tag group containing bounding box of quantized mesh */
+#define TAGGROUP_BBOX_CT 0
+
+/* Custom type of tag containing minimum of bounding box (REAL64 x3) */
+#define TAG_BBOX_MIN_CT    0
+/* Custom type of tag containing maximum of bounding box (REAL64 x3) */
+#define TAG_BBOX_MAX_CT    1
+/* Custom type of tag containing number of quantization bits (UINT8) */
+#define TAG_QUANT_BITS_CT  2
+/* Custom type of tag containing maximal quantization error (REAL64 x3) */
+#define TAG_QUANT_ERROR_CT 3
+
+struct PropLayer;
+struct Quantization;
+struct SPSCQueue;
+struct LiveResync;
+struct Verifier;
+struct Download;
 
 /**
  * Client context
@@ -60,6 +100,62 @@ typedef struct CTX {
 	 */
 	char *my_filename;
 
+	/**
+	 * Comma separated list of extra vertex properties selected for upload
+	 */
+	char *my_props;
+
+	/**
+	 * Number of threads used for processing of mesh (0 means all CPUs)
+	 */
+	int nthreads;
+
+	/**
+	 * Flag of computing vertex normals, when PLY file does not contain them
+	 */
+	int compute_normals;
+
+	/**
+	 * Flag of moving center of bounding box to the origin
+	 */
+	int recenter;
+
+	/**
+	 * Uniform scale of mesh
+	 */
+	double scale;
+
+	/**
+	 * Permutation of axes (e.g. "x-zy")
+	 */
+	char *my_axes;
+
+	/**
+	 * Comma separated 4x4 matrix (row-major) applied to vertices
+	 */
+	char *my_matrix;
+
+	/**
+	 * Number of bits of quantized coordinates (0 means no quantization)
+	 */
+	int quant_bits;
+
+	/**
+	 * Partition faces to meshlets and upload their bounds
+	 */
+	int meshlets;
+
+	/**
+	 * Only load and validate PLY file without connecting to server
+	 */
+	int check_only;
+
+	/**
+	 * Remove invalid faces and reset non-finite coordinates instead of
+	 * failing validation
+	 */
+	int repair;
+
 	/**
 	 * Flag of debug print
 	 */
@@ -100,6 +196,11 @@ typedef struct CTX {
 	 */
 	int64_t my_object_node_id;
 
+	/**
+	 * ID of tag group containing bounding box
+	 */
+	int64_t my_bbox_taggroup_id;
+
 	/**
 	 * ID of mesh node
 	 */
@@ -116,9 +217,21 @@ typedef struct CTX {
 	uint64_t nvertices;
 
 	/**
-	 * Array of vertices
+	 * Coordinates of vertices stored as structure of arrays
+	 */
+	mesh_real *vx;
+	mesh_real *vy;
+	mesh_real *vz;
+
+	/**
+	 * Memory containing all buffers of mesh
+	 */
+	struct MeshArena arena;
+
+	/**
+	 * Vertices quantized relative to bounding box or NULL
 	 */
-	double *vertices;
+	struct Quantization *quantization;
 
 	/**
 	 * ID of layer containing faces
@@ -135,6 +248,87 @@ typedef struct CTX {
 	 */
 	uint64_t *quads;
 
+	/**
+	 * Number of vertices of each face (3 or 4)
+	 */
+	uint8_t *face_sizes;
+
+	/**
+	 * Number of layers containing extra vertex properties
+	 */
+	int nprop_layers;
+
+	/**
+	 * Array of layers containing extra vertex properties
+	 */
+	struct PropLayer *prop_layers;
+
+	/**
+	 * Flag of started upload of mesh
+	 */
+	int mesh_uploaded;
+
+	/**
+	 * Metrics of loading and upload
+	 */
+	struct Metrics metrics;
+
+	/**
+	 * Terminate connection, when all items were received back from server
+	 */
+	int exit_after_upload;
+
+	/**
+	 * Flag of running session with server
+	 */
+	int session_running;
+
+	/**
+	 * Compare mesh received back from server with loaded mesh
+	 */
+	int verify;
+
+	/**
+	 * Time without received items, when download or verification
+	 * is finished (seconds)
+	 */
+	double idle_timeout;
+
+	/**
+	 * Items received back from server used for verification or NULL
+	 */
+	struct Verifier *verifier;
+
+	/**
+	 * Download of existing mesh node to PLY file instead of upload or NULL
+	 */
+	struct Download *download;
+
+	/**
+	 * Show preview of mesh in window
+	 */
+	int display;
+
+	/**
+	 * Show mesh received from server instead of loaded mesh in preview
+	 */
+	int display_live;
+
+	/**
+	 * Maximal number of triangles drawn in one frame of preview
+	 */
+	uint64_t display_budget;
+
+	/**
+	 * Queue of items received from server passed to display thread
+	 */
+	struct SPSCQueue *live_queue;
+
+	/**
+	 * Bitmaps of items dropped from live_queue, because it was full
+	 */
+	struct LiveResync *live_resync;
+
 	/**
 	 *
 	 */
@@ -152,4 +346,8 @@ typedef struct CTX {
 
 void init_CTX(struct CTX *ctx);
 
+void clear_CTX(struct CTX *ctx);
+
+int prepare_mesh(struct CTX *ctx);
+
 #endif /* MAIN_H_ */
@@ -0,0 +1,111 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh.h"
+
+/**
+ * @brief This function returns size rounded up to MESH_ALIGNMENT
+ */
+size_t mesh_arena_size(size_t size)
+{
+	return (size + MESH_ALIGNMENT - 1) & ~(size_t)(MESH_ALIGNMENT - 1);
+}
+
+/**
+ * @brief This function allocates one zeroed and aligned block of memory
+ * for all buffers of mesh. The size should be sum of mesh_arena_size()
+ * of all buffers.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int mesh_arena_init(struct MeshArena *arena, size_t size)
+{
+	void *base = NULL;
+
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+
+	if(size == 0) {
+		return 1;
+	}
+
+	if(posix_memalign(&base, MESH_ALIGNMENT, size) != 0) {
+		return 0;
+	}
+
+	memset(base, 0, size);
+
+	arena->base = (char*)base;
+	arena->size = size;
+
+	return 1;
+}
+
+/**
+ * @brief This function returns next aligned buffer from arena
+ *
+ * @return Pointer at zeroed buffer or NULL, when arena is full
+ */
+void *mesh_arena_alloc(struct MeshArena *arena, size_t size)
+{
+	void *ptr;
+
+	size = mesh_arena_size(size);
+
+	if(arena->base == NULL || arena->used + size > arena->size) {
+		return NULL;
+	}
+
+	ptr = arena->base + arena->used;
+	arena->used += size;
+
+	return ptr;
+}
+
+/**
+ * @brief This function returns 1, when pointer points into arena
+ */
+int mesh_arena_owns(struct MeshArena *arena, const void *ptr)
+{
+	return (arena->base != NULL &&
+			(const char*)ptr >= arena->base &&
+			(const char*)ptr < arena->base + arena->size) ? 1 : 0;
+}
+
+/**
+ * @brief This function frees all buffers of arena at once
+ */
+void mesh_arena_free(struct MeshArena *arena)
+{
+	if(arena->base != NULL) free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef MESH_H_
+#define MESH_H_
+
+/* Real type of coordinates stored in memory. Coordinates are converted
+ * to the wire format (REAL64) only, when they are sent to server. */
+#ifdef WITH_SINGLE_PRECISION
+typedef float mesh_real;
+#else
+typedef double mesh_real;
+#endif
+
+/* Alignment of all buffers allocated from mesh arena */
+#define MESH_ALIGNMENT 64
+
+/**
+ * One contiguous block of memory containing all buffers of mesh
+ */
+typedef struct MeshArena {
+
+	/**
+	 * Start of memory block
+	 */
+	char *base;
+
+	/**
+	 * Size of memory block in bytes
+	 */
+	size_t size;
+
+	/**
+	 * Number of already allocated bytes
+	 */
+	size_t used;
+} MeshArena;
+
+size_t mesh_arena_size(size_t size);
+
+int mesh_arena_init(struct MeshArena *arena, size_t size);
+
+void *mesh_arena_alloc(struct MeshArena *arena, size_t size);
+
+int mesh_arena_owns(struct MeshArena *arena, const void *ptr);
+
+void mesh_arena_free(struct MeshArena *arena);
+
+#endif /* MESH_H_ */
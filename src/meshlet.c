@@ -0,0 +1,461 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <verse.h>
+
+#include "main.h"
+#include "parallel.h"
+#include "bbox.h"
+#include "ply_props.h"
+#include "meshlet.h"
+
+/* Face index is stored in low bits of sort key, Morton code in high bits */
+#define MESHLET_FACE_BITS	34
+#define MESHLET_FACE_MASK	(((uint64_t)1 << MESHLET_FACE_BITS) - 1)
+
+/* Number of bits sorted in one pass of radix sort */
+#define MESHLET_RADIX_BITS	10
+
+/**
+ * Data shared by threads computing Morton codes of faces
+ */
+typedef struct MortonJob {
+	struct CTX *ctx;
+	double min[3];
+	double scale[3];
+	/* Morton code of centroid << MESHLET_FACE_BITS | face index */
+	uint64_t *keys;
+} MortonJob;
+
+/**
+ * Data shared by threads computing bounds of meshlets
+ */
+typedef struct BoundsJob {
+	struct CTX *ctx;
+	/* First face, number of faces and number of vertices of meshlets */
+	const uint32_t *meshlets;
+	/* Bounding spheres: center and radius */
+	float *spheres;
+	/* Normal cones: axis and cosine of half angle */
+	float *cones;
+} BoundsJob;
+
+/**
+ * @brief This function returns number of vertices of face (3 or 4)
+ */
+static inline int face_size(const struct CTX *ctx, uint64_t face_id)
+{
+	return ctx->face_sizes[face_id];
+}
+
+/**
+ * @brief This function spreads 10 bits of value to every third bit
+ */
+static inline uint64_t morton_expand(uint32_t value)
+{
+	uint64_t x = value & ((1 << MESHLET_MORTON_BITS) - 1);
+
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+
+	return x;
+}
+
+/**
+ * @brief This function computes sort keys of faces [first, last) from
+ * Morton codes of their centroids
+ */
+static void morton_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct MortonJob *job = (struct MortonJob*)arg;
+	struct CTX *ctx = job->ctx;
+	const double max_q = (double)((1 << MESHLET_MORTON_BITS) - 1);
+	uint64_t face_id;
+
+	(void)thread_num;
+
+	for(face_id = first; face_id < last; face_id++) {
+		const uint64_t *quad = &ctx->quads[4*face_id];
+		double centroid[3] = {0.0, 0.0, 0.0};
+		uint64_t code = 0;
+		int j, k, n = face_size(ctx, face_id), valid = 0;
+
+		for(j = 0; j < n; j++) {
+			if(quad[j] < ctx->nvertices) {
+				centroid[0] += ctx->vx[quad[j]];
+				centroid[1] += ctx->vy[quad[j]];
+				centroid[2] += ctx->vz[quad[j]];
+				valid++;
+			}
+		}
+
+		for(k = 0; k < 3 && valid > 0; k++) {
+			double q = (centroid[k] / valid - job->min[k]) * job->scale[k];
+			q = (q < 0.0) ? 0.0 : ((q > max_q) ? max_q : q);
+			code |= morton_expand((uint32_t)q) << k;
+		}
+
+		job->keys[face_id] = (code << MESHLET_FACE_BITS) | face_id;
+	}
+}
+
+/**
+ * @brief This function sorts keys by Morton codes with LSD radix sort
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int sort_keys(uint64_t *keys, uint64_t count)
+{
+	uint64_t *tmp, *src = keys, *dst;
+	int shift;
+
+	tmp = (uint64_t*)malloc(count * sizeof(uint64_t));
+	if(tmp == NULL) {
+		return 0;
+	}
+	dst = tmp;
+
+	for(shift = MESHLET_FACE_BITS; shift < 64; shift += MESHLET_RADIX_BITS) {
+		uint64_t offsets[1 << MESHLET_RADIX_BITS];
+		uint64_t i, sum = 0, *swap;
+
+		memset(offsets, 0, sizeof(offsets));
+		for(i = 0; i < count; i++) {
+			offsets[(src[i] >> shift) & ((1 << MESHLET_RADIX_BITS) - 1)]++;
+		}
+		for(i = 0; i < (1 << MESHLET_RADIX_BITS); i++) {
+			uint64_t n = offsets[i];
+			offsets[i] = sum;
+			sum += n;
+		}
+		for(i = 0; i < count; i++) {
+			dst[offsets[(src[i] >> shift) & ((1 << MESHLET_RADIX_BITS) - 1)]++] = src[i];
+		}
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if(src != keys) {
+		memcpy(keys, src, count * sizeof(uint64_t));
+	}
+	free(tmp);
+
+	return 1;
+}
+
+/**
+ * @brief This function computes normal of face with length equal to double
+ * of area of face
+ *
+ * @return 1 on success, 0 for face with invalid index or zero area
+ */
+static int face_normal(const struct CTX *ctx, uint64_t face_id, double *normal)
+{
+	const uint64_t *quad = &ctx->quads[4*face_id];
+	const mesh_real *vx = ctx->vx;
+	const mesh_real *vy = ctx->vy;
+	const mesh_real *vz = ctx->vz;
+	double e1[3], e2[3];
+	uint64_t a, b, c, d;
+	int j;
+
+	for(j = 0; j < face_size(ctx, face_id); j++) {
+		if(quad[j] >= ctx->nvertices) return 0;
+	}
+
+	a = quad[0];
+	b = quad[1];
+	c = quad[2];
+
+	if(face_size(ctx, face_id) == 3) {
+		e1[0] = vx[b] - vx[a]; e1[1] = vy[b] - vy[a]; e1[2] = vz[b] - vz[a];
+		e2[0] = vx[c] - vx[a]; e2[1] = vy[c] - vy[a]; e2[2] = vz[c] - vz[a];
+	} else {
+		d = quad[3];
+		e1[0] = vx[c] - vx[a]; e1[1] = vy[c] - vy[a]; e1[2] = vz[c] - vz[a];
+		e2[0] = vx[d] - vx[b]; e2[1] = vy[d] - vy[b]; e2[2] = vz[d] - vz[b];
+	}
+
+	normal[0] = e1[1]*e2[2] - e1[2]*e2[1];
+	normal[1] = e1[2]*e2[0] - e1[0]*e2[2];
+	normal[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+	return (normal[0] != 0.0 || normal[1] != 0.0 || normal[2] != 0.0) ? 1 : 0;
+}
+
+/**
+ * @brief This function computes bounding spheres and normal cones of
+ * meshlets [first, last). Normal of quad is cross product of diagonals
+ * like in computing of vertex normals.
+ */
+static void bounds_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct BoundsJob *job = (struct BoundsJob*)arg;
+	struct CTX *ctx = job->ctx;
+	const mesh_real *vx = ctx->vx;
+	const mesh_real *vy = ctx->vy;
+	const mesh_real *vz = ctx->vz;
+	uint64_t m;
+
+	(void)thread_num;
+
+	for(m = first; m < last; m++) {
+		uint64_t face_id, face_end = (uint64_t)job->meshlets[3*m] + job->meshlets[3*m + 1];
+		double min[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+		double max[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+		double center[3] = {0.0, 0.0, 0.0}, axis[3] = {0.0, 0.0, 0.0};
+		double radius = 0.0, cutoff = 1.0, len;
+		int j, k;
+
+		/* Center of bounding box of vertices and sum of face normals */
+		for(face_id = job->meshlets[3*m]; face_id < face_end; face_id++) {
+			const uint64_t *quad = &ctx->quads[4*face_id];
+			int n = face_size(ctx, face_id);
+
+			for(j = 0; j < n; j++) {
+				if(quad[j] >= ctx->nvertices) continue;
+				min[0] = fmin(min[0], vx[quad[j]]); max[0] = fmax(max[0], vx[quad[j]]);
+				min[1] = fmin(min[1], vy[quad[j]]); max[1] = fmax(max[1], vy[quad[j]]);
+				min[2] = fmin(min[2], vz[quad[j]]); max[2] = fmax(max[2], vz[quad[j]]);
+			}
+		}
+		/* Radius is measured from center stored in layer */
+		for(k = 0; k < 3; k++) {
+			center[k] = (float)((min[k] <= max[k]) ? 0.5*(min[k] + max[k]) : 0.0);
+		}
+
+		/* Radius and axis of normal cone */
+		for(face_id = job->meshlets[3*m]; face_id < face_end; face_id++) {
+			const uint64_t *quad = &ctx->quads[4*face_id];
+			int n = face_size(ctx, face_id);
+			double normal[3];
+
+			for(j = 0; j < n; j++) {
+				double d[3];
+				if(quad[j] >= ctx->nvertices) continue;
+				d[0] = vx[quad[j]] - center[0];
+				d[1] = vy[quad[j]] - center[1];
+				d[2] = vz[quad[j]] - center[2];
+				radius = fmax(radius, sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]));
+			}
+
+			if(face_normal(ctx, face_id, normal) == 1) {
+				for(k = 0; k < 3; k++) axis[k] += normal[k];
+			}
+		}
+
+		len = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+		if(len > 0.0) {
+			for(k = 0; k < 3; k++) axis[k] /= len;
+
+			/* Cosine of the largest angle between axis and face normal */
+			for(face_id = job->meshlets[3*m]; face_id < face_end; face_id++) {
+				double normal[3];
+
+				if(face_normal(ctx, face_id, normal) == 1) {
+					len = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+					cutoff = fmin(cutoff, (normal[0]*axis[0] + normal[1]*axis[1] + normal[2]*axis[2]) / len);
+				}
+			}
+		} else {
+			cutoff = -1.0;
+		}
+
+		for(k = 0; k < 3; k++) {
+			job->spheres[4*m + k] = (float)center[k];
+			job->cones[4*m + k] = (float)axis[k];
+		}
+		/* Rounding must not make sphere smaller or cone narrower */
+		job->spheres[4*m + 3] = nextafterf((float)radius, HUGE_VALF);
+		job->cones[4*m + 3] = nextafterf((float)cutoff, -HUGE_VALF);
+	}
+}
+
+/**
+ * @brief This function finds vertices of face, that are not used by
+ * meshlet yet
+ *
+ * @param added	The array of new vertices (at most four)
+ * @return Number of new vertices
+ */
+static int new_vertices(const uint64_t *quad, int n, const uint64_t *vertices,
+		int nvertices, uint64_t *added)
+{
+	int j, l, nadded = 0;
+
+	for(j = 0; j < n; j++) {
+		for(l = 0; l < nvertices && vertices[l] != quad[j]; l++);
+		if(l < nvertices) continue;
+		for(l = 0; l < nadded && added[l] != quad[j]; l++);
+		if(l < nadded) continue;
+		added[nadded++] = quad[j];
+	}
+
+	return nadded;
+}
+
+/**
+ * @brief This function partitions faces to meshlets with at most
+ * MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles.
+ * Faces are sorted by Morton code of their centroids and appended to
+ * meshlet until any limit would be exceeded. Faces are reordered, so
+ * each meshlet is continuous range of faces, and three layers indexed
+ * by meshlet are added: range of faces with number of vertices
+ * (UINT32 x3), bounding sphere (REAL32 x4: center, radius) and normal
+ * cone (REAL32 x4: axis, cosine of half angle; -1 means no cone).
+ *
+ * @return 1 on success, 0 on failure
+ */
+int build_meshlets(struct CTX *ctx)
+{
+	struct MortonJob morton;
+	struct BoundsJob bounds;
+	struct PropLayer *layers[3];
+	struct BBox bbox;
+	uint64_t vertices[MESHLET_MAX_VERTICES], added[4];
+	uint64_t *keys, *quads, k, first = 0, nmeshlets = 0, total_vertices = 0;
+	uint32_t *meshlets;
+	uint8_t *sizes;
+	int nvertices = 0, ntriangles = 0, nthreads, nadded, i;
+
+	if(ctx->nquads == 0) {
+		return 1;
+	}
+
+	if(ctx->nquads > MESHLET_FACE_MASK || ctx->nquads > UINT32_MAX) {
+		printf("ERROR: Too many faces for meshlets: %lu\n", (unsigned long)ctx->nquads);
+		return 0;
+	}
+
+	if(mesh_bbox(ctx, &bbox) != 1) {
+		return 0;
+	}
+
+	/* There is at most one meshlet per face */
+	keys = (uint64_t*)malloc(ctx->nquads * sizeof(uint64_t));
+	quads = (uint64_t*)malloc(4 * ctx->nquads * sizeof(uint64_t));
+	meshlets = (uint32_t*)malloc(3 * ctx->nquads * sizeof(uint32_t));
+	sizes = (uint8_t*)malloc(ctx->nquads * sizeof(uint8_t));
+	if(keys == NULL || quads == NULL || meshlets == NULL || sizes == NULL) {
+		free(keys);
+		free(quads);
+		free(meshlets);
+		free(sizes);
+		return 0;
+	}
+
+	morton.ctx = ctx;
+	morton.keys = keys;
+	for(i = 0; i < 3; i++) {
+		double extent = bbox.max[i] - bbox.min[i];
+		morton.min[i] = bbox.min[i];
+		morton.scale[i] = (extent > 0.0) ? ((1 << MESHLET_MORTON_BITS) - 1) / extent : 0.0;
+	}
+
+	nthreads = parallel_threads(ctx->nthreads, ctx->nquads);
+	if(parallel_for(nthreads, ctx->nquads, morton_range, &morton) != 0 ||
+			sort_keys(keys, ctx->nquads) != 1) {
+		free(keys);
+		free(quads);
+		free(meshlets);
+		free(sizes);
+		return 0;
+	}
+
+	/* Append faces to meshlets in Morton order */
+	for(k = 0; k < ctx->nquads; k++) {
+		uint64_t face_id = keys[k] & MESHLET_FACE_MASK;
+		const uint64_t *quad = &ctx->quads[4*face_id];
+		int n = face_size(ctx, face_id);
+
+		nadded = new_vertices(quad, n, vertices, nvertices, added);
+		if(ntriangles + n - 2 > MESHLET_MAX_TRIANGLES ||
+				nvertices + nadded > MESHLET_MAX_VERTICES) {
+			meshlets[3*nmeshlets] = (uint32_t)first;
+			meshlets[3*nmeshlets + 1] = (uint32_t)(k - first);
+			meshlets[3*nmeshlets + 2] = (uint32_t)nvertices;
+			total_vertices += nvertices;
+			nmeshlets++;
+			first = k;
+			nvertices = 0;
+			ntriangles = 0;
+			nadded = new_vertices(quad, n, vertices, nvertices, added);
+		}
+
+		memcpy(&vertices[nvertices], added, nadded * sizeof(uint64_t));
+		nvertices += nadded;
+		ntriangles += n - 2;
+		memcpy(&quads[4*k], quad, 4 * sizeof(uint64_t));
+		sizes[k] = (uint8_t)n;
+	}
+	meshlets[3*nmeshlets] = (uint32_t)first;
+	meshlets[3*nmeshlets + 1] = (uint32_t)(k - first);
+	meshlets[3*nmeshlets + 2] = (uint32_t)nvertices;
+	total_vertices += nvertices;
+	nmeshlets++;
+
+	memcpy(ctx->quads, quads, 4 * ctx->nquads * sizeof(uint64_t));
+	memcpy(ctx->face_sizes, sizes, ctx->nquads * sizeof(uint8_t));
+	free(quads);
+	free(sizes);
+	free(keys);
+
+	layers[0] = ply_props_add(ctx, "meshlet", LAYER_MESHLETS_CT,
+			VRS_VALUE_TYPE_UINT32, 3, nmeshlets);
+	layers[1] = (layers[0] != NULL) ? ply_props_add(ctx, "meshlet_sphere",
+			LAYER_MESHLET_SPHERES_CT, VRS_VALUE_TYPE_REAL32, 4, nmeshlets) : NULL;
+	layers[2] = (layers[1] != NULL) ? ply_props_add(ctx, "meshlet_cone",
+			LAYER_MESHLET_CONES_CT, VRS_VALUE_TYPE_REAL32, 4, nmeshlets) : NULL;
+	if(layers[2] == NULL) {
+		printf("ERROR: Unable to add layers of meshlets\n");
+		free(meshlets);
+		return 0;
+	}
+	memcpy(layers[0]->data, meshlets, 3 * nmeshlets * sizeof(uint32_t));
+	free(meshlets);
+
+	bounds.ctx = ctx;
+	bounds.meshlets = (const uint32_t*)layers[0]->data;
+	bounds.spheres = (float*)layers[1]->data;
+	bounds.cones = (float*)layers[2]->data;
+	if(parallel_for(nthreads, nmeshlets, bounds_range, &bounds) != 0) {
+		return 0;
+	}
+
+	printf("meshlets: %lu, average vertices: %.1f, average faces: %.1f\n",
+			(unsigned long)nmeshlets,
+			(double)total_vertices / nmeshlets,
+			(double)ctx->nquads / nmeshlets);
+
+	return 1;
+}
@@ -0,0 +1,42 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#ifndef MESHLET_H_
+#define MESHLET_H_
+
+/* Maximal number of unique vertices of one meshlet */
+#define MESHLET_MAX_VERTICES 64
+
+/* Maximal number of triangles of one meshlet (quad is two triangles) */
+#define MESHLET_MAX_TRIANGLES 124
+
+/* Number of bits of one coordinate of Morton code of face */
+#define MESHLET_MORTON_BITS 10
+
+struct CTX;
+
+int build_meshlets(struct CTX *ctx);
+
+#endif /* MESHLET_H_ */
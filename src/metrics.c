@@ -0,0 +1,406 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "trace.h"
+#include "metrics.h"
+
+/* Maximal size of one snapshot of metrics */
+#define METRICS_BUFFER_SIZE	4096
+
+/* Name of duration between phase and next phase */
+static const char *phase_names[METRICS_PHASES - 1] = {
+	"connect",
+	"authenticate",
+	"nodes",
+	"layers",
+	"upload"
+};
+
+/**
+ * @brief This function returns time of monotonic clock in nanoseconds
+ */
+uint64_t metrics_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief This function initializes metrics. Writer is not started.
+ */
+void metrics_init(struct Metrics *metrics)
+{
+	int i;
+
+	atomic_init(&metrics->parse_ns, 0);
+	atomic_init(&metrics->bytes_read, 0);
+	atomic_init(&metrics->vertices, 0);
+	atomic_init(&metrics->faces, 0);
+	atomic_init(&metrics->items_queued, 0);
+	atomic_init(&metrics->bytes_queued, 0);
+	atomic_init(&metrics->items_acked, 0);
+	for(i = 0; i < METRICS_PHASES; i++) {
+		atomic_init(&metrics->phases[i], 0);
+	}
+	metrics->path = NULL;
+	metrics->format = METRICS_FORMAT_PROMETHEUS;
+	metrics->interval = METRICS_INTERVAL;
+	metrics->running = 0;
+	metrics->last_items = 0;
+	metrics->last_time = 0;
+}
+
+/**
+ * @brief This function stores time of phase, when it is reached for
+ * the first time
+ */
+void metrics_phase(struct Metrics *metrics, int phase)
+{
+	if(metrics_get(&metrics->phases[phase]) == 0) {
+		atomic_store_explicit(&metrics->phases[phase], metrics_now(), memory_order_relaxed);
+	}
+}
+
+/**
+ * @brief This function returns 1, when phase was reached
+ */
+int metrics_phase_reached(struct Metrics *metrics, int phase)
+{
+	return (metrics_get(&metrics->phases[phase]) != 0) ? 1 : 0;
+}
+
+/**
+ * @brief This function returns duration between two phases in seconds
+ * or 0, when any of them was not reached
+ */
+double metrics_duration(struct Metrics *metrics, int from, int to)
+{
+	uint64_t t0 = metrics_get(&metrics->phases[from]);
+	uint64_t t1 = metrics_get(&metrics->phases[to]);
+
+	return (t0 != 0 && t1 >= t0) ? (t1 - t0) * 1e-9 : 0.0;
+}
+
+/**
+ * @brief This function returns name of interval between phase and the
+ * next phase
+ */
+const char *metrics_phase_name(int phase)
+{
+	return phase_names[phase];
+}
+
+/**
+ * @brief This function returns format of metrics or -1 for unknown format
+ */
+int metrics_parse_format(const char *str)
+{
+	if(strcmp(str, "prometheus") == 0) {
+		return METRICS_FORMAT_PROMETHEUS;
+	} else if(strcmp(str, "json") == 0) {
+		return METRICS_FORMAT_JSON;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief This function formats snapshot of metrics to the buffer
+ *
+ * @return Length of formatted text
+ */
+static size_t metrics_format(struct Metrics *metrics, char *buf, size_t size)
+{
+	uint64_t now = metrics_now();
+	uint64_t queued = metrics_get(&metrics->items_queued);
+	uint64_t acked = metrics_get(&metrics->items_acked);
+	double rate = 0.0;
+	size_t len = 0;
+	int i;
+
+	if(metrics->last_time != 0 && now > metrics->last_time) {
+		rate = (queued - metrics->last_items) / ((now - metrics->last_time) * 1e-9);
+	}
+	metrics->last_items = queued;
+	metrics->last_time = now;
+
+#define APPEND(...) \
+	if(len < size) len += snprintf(buf + len, size - len, __VA_ARGS__)
+
+	if(metrics->format == METRICS_FORMAT_JSON) {
+		APPEND("{\"parse_seconds\": %.9f, ", metrics_get(&metrics->parse_ns) * 1e-9);
+		APPEND("\"bytes_read\": %lu, ", (unsigned long)metrics_get(&metrics->bytes_read));
+		APPEND("\"vertices\": %lu, ", (unsigned long)metrics_get(&metrics->vertices));
+		APPEND("\"faces\": %lu, ", (unsigned long)metrics_get(&metrics->faces));
+		APPEND("\"items_queued\": %lu, ", (unsigned long)queued);
+		APPEND("\"bytes_queued\": %lu, ", (unsigned long)metrics_get(&metrics->bytes_queued));
+		APPEND("\"items_acked\": %lu, ", (unsigned long)acked);
+		APPEND("\"items_in_flight\": %lu, ", (unsigned long)(queued - acked));
+		APPEND("\"send_rate\": %.1f, ", rate);
+		APPEND("\"phase_seconds\": {");
+		for(i = 0; i < METRICS_PHASES - 1; i++) {
+			APPEND("%s\"%s\": %.9f", (i == 0) ? "" : ", ",
+					phase_names[i], metrics_duration(metrics, i, i + 1));
+		}
+		APPEND("}}\n");
+	} else {
+		APPEND("# HELP verse_ply_uploader_parse_seconds Duration of loading of PLY file.\n");
+		APPEND("# TYPE verse_ply_uploader_parse_seconds gauge\n");
+		APPEND("verse_ply_uploader_parse_seconds %.9f\n", metrics_get(&metrics->parse_ns) * 1e-9);
+		APPEND("# HELP verse_ply_uploader_bytes_read_total Bytes of PLY file.\n");
+		APPEND("# TYPE verse_ply_uploader_bytes_read_total counter\n");
+		APPEND("verse_ply_uploader_bytes_read_total %lu\n", (unsigned long)metrics_get(&metrics->bytes_read));
+		APPEND("# HELP verse_ply_uploader_vertices Loaded vertices.\n");
+		APPEND("# TYPE verse_ply_uploader_vertices gauge\n");
+		APPEND("verse_ply_uploader_vertices %lu\n", (unsigned long)metrics_get(&metrics->vertices));
+		APPEND("# HELP verse_ply_uploader_faces Loaded faces.\n");
+		APPEND("# TYPE verse_ply_uploader_faces gauge\n");
+		APPEND("verse_ply_uploader_faces %lu\n", (unsigned long)metrics_get(&metrics->faces));
+		APPEND("# HELP verse_ply_uploader_items_queued_total Items of layers sent to server.\n");
+		APPEND("# TYPE verse_ply_uploader_items_queued_total counter\n");
+		APPEND("verse_ply_uploader_items_queued_total %lu\n", (unsigned long)queued);
+		APPEND("# HELP verse_ply_uploader_bytes_queued_total Bytes of values of items sent to server.\n");
+		APPEND("# TYPE verse_ply_uploader_bytes_queued_total counter\n");
+		APPEND("verse_ply_uploader_bytes_queued_total %lu\n", (unsigned long)metrics_get(&metrics->bytes_queued));
+		APPEND("# HELP verse_ply_uploader_items_acked_total Items received back from server.\n");
+		APPEND("# TYPE verse_ply_uploader_items_acked_total counter\n");
+		APPEND("verse_ply_uploader_items_acked_total %lu\n", (unsigned long)acked);
+		APPEND("# HELP verse_ply_uploader_items_in_flight Items sent and not received back.\n");
+		APPEND("# TYPE verse_ply_uploader_items_in_flight gauge\n");
+		APPEND("verse_ply_uploader_items_in_flight %lu\n", (unsigned long)(queued - acked));
+		APPEND("# HELP verse_ply_uploader_send_rate Items sent per second since previous sample.\n");
+		APPEND("# TYPE verse_ply_uploader_send_rate gauge\n");
+		APPEND("verse_ply_uploader_send_rate %.1f\n", rate);
+		APPEND("# HELP verse_ply_uploader_phase_seconds Duration of phase of session.\n");
+		APPEND("# TYPE verse_ply_uploader_phase_seconds gauge\n");
+		for(i = 0; i < METRICS_PHASES - 1; i++) {
+			APPEND("verse_ply_uploader_phase_seconds{phase=\"%s\"} %.9f\n",
+					phase_names[i], metrics_duration(metrics, i, i + 1));
+		}
+	}
+
+#undef APPEND
+
+	return (len < size) ? len : size - 1;
+}
+
+/**
+ * @brief This function sends snapshot to UNIX socket. New connection is
+ * used for every snapshot, so receiver can be restarted any time.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int metrics_send(const char *path, const char *buf, size_t len)
+{
+	struct sockaddr_un addr;
+	int fd, ret = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr.sun_path)) {
+		return 0;
+	}
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1) {
+		return 0;
+	}
+
+	if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return 0;
+	}
+
+	while(len > 0) {
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+		if(n < 0) {
+			if(errno == EINTR) continue;
+			ret = 0;
+			break;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+/**
+ * @brief This function writes snapshot to temporary file and renames it,
+ * so readers never see partially written file.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int metrics_save(const char *path, const char *buf, size_t len)
+{
+	char tmp_path[1024];
+	FILE *file;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	file = fopen(tmp_path, "w");
+	if(file == NULL) {
+		return 0;
+	}
+
+	if(fwrite(buf, 1, len, file) != len) {
+		fclose(file);
+		return 0;
+	}
+	fclose(file);
+
+	return (rename(tmp_path, path) == 0) ? 1 : 0;
+}
+
+/**
+ * @brief This function writes one snapshot of metrics
+ */
+static int metrics_write(struct Metrics *metrics)
+{
+	char buf[METRICS_BUFFER_SIZE];
+	size_t len = metrics_format(metrics, buf, sizeof(buf));
+	size_t prefix = strlen(METRICS_UNIX_PREFIX);
+
+	if(strncmp(metrics->path, METRICS_UNIX_PREFIX, prefix) == 0) {
+		return metrics_send(metrics->path + prefix, buf, len);
+	}
+
+	return metrics_save(metrics->path, buf, len);
+}
+
+/**
+ * @brief Writer thread writing metrics periodically
+ */
+static void *metrics_thread(void *arg)
+{
+	struct Metrics *metrics = (struct Metrics*)arg;
+	struct timespec deadline;
+
+	trace_thread_name("metrics");
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+
+	pthread_mutex_lock(&metrics->mutex);
+	while(metrics->running == 1) {
+		uint64_t start, ns = deadline.tv_nsec + (uint64_t)(metrics->interval * 1e9);
+
+		deadline.tv_sec += ns / 1000000000ULL;
+		deadline.tv_nsec = ns % 1000000000ULL;
+
+		pthread_cond_timedwait(&metrics->cond, &metrics->mutex, &deadline);
+		if(metrics->running == 0) break;
+		pthread_mutex_unlock(&metrics->mutex);
+
+		start = trace_begin();
+		metrics_write(metrics);
+		trace_end("metrics_write", "metrics", start, -1);
+
+		pthread_mutex_lock(&metrics->mutex);
+	}
+	pthread_mutex_unlock(&metrics->mutex);
+
+	return NULL;
+}
+
+/**
+ * @brief This function starts writer thread, when path of metrics is set
+ *
+ * @return 1 on success, 0 on failure
+ */
+int metrics_start(struct Metrics *metrics)
+{
+	if(metrics->path == NULL) {
+		return 1;
+	}
+
+	if(metrics->interval <= 0.0) {
+		printf("ERROR: Interval of metrics has to be positive number\n");
+		return 0;
+	}
+
+	pthread_mutex_init(&metrics->mutex, NULL);
+	pthread_cond_init(&metrics->cond, NULL);
+	metrics->last_items = metrics_get(&metrics->items_queued);
+	metrics->last_time = metrics_now();
+	metrics->running = 1;
+
+	if(pthread_create(&metrics->thread, NULL, metrics_thread, metrics) != 0) {
+		metrics->running = 0;
+		pthread_cond_destroy(&metrics->cond);
+		pthread_mutex_destroy(&metrics->mutex);
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function stops writer thread and writes final snapshot
+ * of metrics.
+ */
+void metrics_stop(struct Metrics *metrics)
+{
+	if(metrics->running == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&metrics->mutex);
+	metrics->running = 0;
+	pthread_cond_signal(&metrics->cond);
+	pthread_mutex_unlock(&metrics->mutex);
+
+	pthread_join(metrics->thread, NULL);
+	pthread_cond_destroy(&metrics->cond);
+	pthread_mutex_destroy(&metrics->mutex);
+
+	metrics_write(metrics);
+}
+
+/**
+ * @brief This function stops writer and frees path of metrics
+ */
+void metrics_clear(struct Metrics *metrics)
+{
+	metrics_stop(metrics);
+	if(metrics->path != NULL) {
+		free(metrics->path);
+		metrics->path = NULL;
+	}
+}
@@ -0,0 +1,139 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+/* Default interval of writing of metrics in seconds */
+#define METRICS_INTERVAL	1.0
+
+/* Prefix of path of UNIX socket */
+#define METRICS_UNIX_PREFIX	"unix:"
+
+/* Formats of metrics */
+#define METRICS_FORMAT_PROMETHEUS	0
+#define METRICS_FORMAT_JSON		1
+
+/**
+ * Phases of session with server. Phase is reached, when the event
+ * happens for the first time.
+ */
+typedef enum MetricsPhase {
+	/* Connect request was sent */
+	METRICS_CONNECT_REQUEST = 0,
+	/* Server asked for authentication */
+	METRICS_AUTHENTICATE,
+	/* Connection was accepted */
+	METRICS_CONNECT_ACCEPT,
+	/* Object and mesh nodes were created */
+	METRICS_NODES_CREATED,
+	/* All layers were created and upload started */
+	METRICS_LAYERS_CREATED,
+	/* All items were received back from server */
+	METRICS_UPLOAD_DONE,
+	METRICS_PHASES
+} MetricsPhase;
+
+/**
+ * Metrics of loading and upload of mesh. Every counter is updated by
+ * one thread only and it is read by writer thread, so relaxed atomic
+ * load and store are used instead of locked instructions.
+ */
+typedef struct Metrics {
+	/* Duration of loading of PLY file in nanoseconds */
+	atomic_uint_fast64_t parse_ns;
+	/* Size of PLY file */
+	atomic_uint_fast64_t bytes_read;
+	/* Number of loaded vertices and faces */
+	atomic_uint_fast64_t vertices;
+	atomic_uint_fast64_t faces;
+	/* Number of items of layers sent to server */
+	atomic_uint_fast64_t items_queued;
+	/* Number of bytes of values of items sent to server */
+	atomic_uint_fast64_t bytes_queued;
+	/* Number of items received back from server */
+	atomic_uint_fast64_t items_acked;
+	/* Times of phases in nanoseconds of monotonic clock (0 = not reached) */
+	atomic_uint_fast64_t phases[METRICS_PHASES];
+	/* File or UNIX socket (METRICS_UNIX_PREFIX) of writer or NULL */
+	char *path;
+	/* Format of metrics (METRICS_FORMAT_PROMETHEUS or METRICS_FORMAT_JSON) */
+	int format;
+	/* Interval of writing in seconds */
+	double interval;
+	/* Writer thread */
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int running;
+	/* Previous sample of items_queued used for computing of send rate */
+	uint64_t last_items;
+	uint64_t last_time;
+} Metrics;
+
+/**
+ * @brief This function adds value to the counter. Counter has only one
+ * writer, so read-modify-write does not have to be atomic.
+ */
+static inline void metrics_add(atomic_uint_fast64_t *counter, uint64_t value)
+{
+	atomic_store_explicit(counter,
+			atomic_load_explicit(counter, memory_order_relaxed) + value,
+			memory_order_relaxed);
+}
+
+/**
+ * @brief This function returns value of the counter
+ */
+static inline uint64_t metrics_get(atomic_uint_fast64_t *counter)
+{
+	return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void metrics_init(struct Metrics *metrics);
+
+uint64_t metrics_now(void);
+
+void metrics_phase(struct Metrics *metrics, int phase);
+
+int metrics_phase_reached(struct Metrics *metrics, int phase);
+
+double metrics_duration(struct Metrics *metrics, int from, int to);
+
+const char *metrics_phase_name(int phase);
+
+int metrics_parse_format(const char *str);
+
+int metrics_start(struct Metrics *metrics);
+
+void metrics_stop(struct Metrics *metrics);
+
+void metrics_clear(struct Metrics *metrics);
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,251 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <verse.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "main.h"
+#include "parallel.h"
+#include "normals.h"
+
+/**
+ * Data shared by threads computing normals
+ */
+typedef struct NormalsJob {
+	struct CTX *ctx;
+	/* Per-thread accumulators of normals (structure of arrays) */
+	float **acc_x;
+	float **acc_y;
+	float **acc_z;
+	int nthreads;
+	/* Interleaved output normals (x, y, z for each vertex) */
+	float *normals;
+} NormalsJob;
+
+/**
+ * @brief This function adds area weighted normals of faces [first, last)
+ * to the accumulator of this thread.
+ *
+ * Cross product of triangle edges and cross product of quad diagonals
+ * have length equal to double of area of face, so no extra weighting
+ * is needed.
+ */
+static void accumulate_faces(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct NormalsJob *job = (struct NormalsJob*)arg;
+	const mesh_real *vx = job->ctx->vx;
+	const mesh_real *vy = job->ctx->vy;
+	const mesh_real *vz = job->ctx->vz;
+	const uint64_t *quads = job->ctx->quads;
+	const uint8_t *face_sizes = job->ctx->face_sizes;
+	uint64_t nvertices = job->ctx->nvertices;
+	float *acc_x = job->acc_x[thread_num];
+	float *acc_y = job->acc_y[thread_num];
+	float *acc_z = job->acc_z[thread_num];
+	uint64_t face_id;
+	int j, nindices;
+
+	for(face_id = first; face_id < last; face_id++) {
+		const uint64_t *quad = &quads[4*face_id];
+		uint64_t a, b, c, d;
+		double e1[3], e2[3], n[3];
+
+		if(quad[0] >= nvertices || quad[1] >= nvertices ||
+				quad[2] >= nvertices || quad[3] >= nvertices) {
+			continue;
+		}
+
+		a = quad[0];
+		b = quad[1];
+		c = quad[2];
+
+		if(face_sizes[face_id] == 3) {
+			nindices = 3;
+			e1[0] = vx[b] - vx[a]; e1[1] = vy[b] - vy[a]; e1[2] = vz[b] - vz[a];
+			e2[0] = vx[c] - vx[a]; e2[1] = vy[c] - vy[a]; e2[2] = vz[c] - vz[a];
+		} else {
+			nindices = 4;
+			d = quad[3];
+			e1[0] = vx[c] - vx[a]; e1[1] = vy[c] - vy[a]; e1[2] = vz[c] - vz[a];
+			e2[0] = vx[d] - vx[b]; e2[1] = vy[d] - vy[b]; e2[2] = vz[d] - vz[b];
+		}
+
+		n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+		n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+		n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+		for(j = 0; j < nindices; j++) {
+			acc_x[quad[j]] += (float)n[0];
+			acc_y[quad[j]] += (float)n[1];
+			acc_z[quad[j]] += (float)n[2];
+		}
+	}
+}
+
+/**
+ * @brief This function sums accumulators of all threads for vertices
+ * [first, last), normalizes the sums and stores them as interleaved
+ * normals. The sum and normalization are vectorized with SSE.
+ */
+static void reduce_normals(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct NormalsJob *job = (struct NormalsJob*)arg;
+	float *normals = job->normals;
+	uint64_t i = first;
+	int t;
+
+	(void)thread_num;
+
+#ifdef __SSE__
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		float tmp_x[4], tmp_y[4], tmp_z[4];
+		int k;
+
+		for(; i + 4 <= last; i += 4) {
+			__m128 x = _mm_loadu_ps(&job->acc_x[0][i]);
+			__m128 y = _mm_loadu_ps(&job->acc_y[0][i]);
+			__m128 z = _mm_loadu_ps(&job->acc_z[0][i]);
+			__m128 len, mask;
+
+			for(t = 1; t < job->nthreads; t++) {
+				x = _mm_add_ps(x, _mm_loadu_ps(&job->acc_x[t][i]));
+				y = _mm_add_ps(y, _mm_loadu_ps(&job->acc_y[t][i]));
+				z = _mm_add_ps(z, _mm_loadu_ps(&job->acc_z[t][i]));
+			}
+
+			len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+			len = _mm_sqrt_ps(len);
+			/* Vertices without faces keep zero normal */
+			mask = _mm_cmpgt_ps(len, zero);
+			len = _mm_div_ps(one, _mm_or_ps(_mm_and_ps(mask, len), _mm_andnot_ps(mask, one)));
+			len = _mm_and_ps(mask, len);
+
+			_mm_storeu_ps(tmp_x, _mm_mul_ps(x, len));
+			_mm_storeu_ps(tmp_y, _mm_mul_ps(y, len));
+			_mm_storeu_ps(tmp_z, _mm_mul_ps(z, len));
+
+			for(k = 0; k < 4; k++) {
+				normals[3*(i + k) + 0] = tmp_x[k];
+				normals[3*(i + k) + 1] = tmp_y[k];
+				normals[3*(i + k) + 2] = tmp_z[k];
+			}
+		}
+	}
+#endif
+
+	for(; i < last; i++) {
+		float x = job->acc_x[0][i], y = job->acc_y[0][i], z = job->acc_z[0][i];
+		float len;
+
+		for(t = 1; t < job->nthreads; t++) {
+			x += job->acc_x[t][i];
+			y += job->acc_y[t][i];
+			z += job->acc_z[t][i];
+		}
+
+		len = sqrtf(x*x + y*y + z*z);
+		len = (len > 0.0f) ? 1.0f/len : 0.0f;
+
+		normals[3*i + 0] = x*len;
+		normals[3*i + 1] = y*len;
+		normals[3*i + 2] = z*len;
+	}
+}
+
+/**
+ * @brief This function computes area weighted vertex normals of mesh.
+ *
+ * Faces are split between threads and each thread accumulates normals
+ * of its faces into its own buffer, so no atomic operations are needed.
+ * The buffers are summed and normalized in second parallel pass split
+ * by vertices. Number of threads is limited by NORMALS_MAX_ACC_MEMORY.
+ *
+ * @param normals	The array of 3*nvertices floats
+ * @return 1 on success, 0 on failure
+ */
+int compute_vertex_normals(struct CTX *ctx, float *normals)
+{
+	struct NormalsJob job;
+	uint64_t acc_size = 3 * ctx->nvertices * sizeof(float);
+	int nthreads, t, ret = 1;
+
+	nthreads = parallel_threads(ctx->nthreads, ctx->nquads);
+	while(nthreads > 1 && nthreads * acc_size > NORMALS_MAX_ACC_MEMORY) {
+		nthreads--;
+	}
+
+	job.ctx = ctx;
+	job.nthreads = nthreads;
+	job.normals = normals;
+	job.acc_x = (float**)calloc(nthreads, sizeof(float*));
+	job.acc_y = (float**)calloc(nthreads, sizeof(float*));
+	job.acc_z = (float**)calloc(nthreads, sizeof(float*));
+
+	if(job.acc_x == NULL || job.acc_y == NULL || job.acc_z == NULL) {
+		ret = 0;
+		goto end;
+	}
+
+	for(t = 0; t < nthreads; t++) {
+		job.acc_x[t] = (float*)calloc(ctx->nvertices, sizeof(float));
+		job.acc_y[t] = (float*)calloc(ctx->nvertices, sizeof(float));
+		job.acc_z[t] = (float*)calloc(ctx->nvertices, sizeof(float));
+		if(job.acc_x[t] == NULL || job.acc_y[t] == NULL || job.acc_z[t] == NULL) {
+			ret = 0;
+			goto end;
+		}
+	}
+
+	if(parallel_for(nthreads, ctx->nquads, accumulate_faces, &job) != 0 ||
+			parallel_for(parallel_threads(ctx->nthreads, ctx->nvertices),
+					ctx->nvertices, reduce_normals, &job) != 0) {
+		ret = 0;
+	}
+
+	if(ctx->print_debug) {
+		printf("%s(): vertices: %lu, faces: %lu, threads: %d\n",
+				__func__, ctx->nvertices, ctx->nquads, nthreads);
+	}
+
+end:
+	for(t = 0; t < nthreads; t++) {
+		if(job.acc_x != NULL && job.acc_x[t] != NULL) free(job.acc_x[t]);
+		if(job.acc_y != NULL && job.acc_y[t] != NULL) free(job.acc_y[t]);
+		if(job.acc_z != NULL && job.acc_z[t] != NULL) free(job.acc_z[t]);
+	}
+	if(job.acc_x != NULL) free(job.acc_x);
+	if(job.acc_y != NULL) free(job.acc_y);
+	if(job.acc_z != NULL) free(job.acc_z);
+
+	return ret;
+}
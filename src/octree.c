@@ -0,0 +1,491 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <verse.h>
+
+#include "main.h"
+#include "bbox.h"
+#include "octree.h"
+
+/**
+ * State of octree builder
+ */
+typedef struct OctreeBuilder {
+	struct CTX *ctx;
+	struct Octree *octree;
+	/* Temporary buffer used for partitioning of triangles */
+	uint32_t *tmp;
+} OctreeBuilder;
+
+/**
+ * @brief This function adds new empty node to octree
+ *
+ * @return Index of new node or -1 on failure
+ */
+static int32_t octree_node_add(struct Octree *octree)
+{
+	struct OctreeNode *node;
+	int i;
+
+	if(octree->nnodes == octree->capacity) {
+		uint32_t capacity = (octree->capacity > 0) ? 2*octree->capacity : 64;
+		struct OctreeNode *nodes = (struct OctreeNode*)realloc(octree->nodes,
+				capacity * sizeof(struct OctreeNode));
+		if(nodes == NULL) {
+			return -1;
+		}
+		octree->nodes = nodes;
+		octree->capacity = capacity;
+	}
+
+	node = &octree->nodes[octree->nnodes];
+	for(i = 0; i < 3; i++) {
+		node->min[i] = FLT_MAX;
+		node->max[i] = -FLT_MAX;
+	}
+	for(i = 0; i < 8; i++) {
+		node->children[i] = -1;
+	}
+	node->first = node->count = 0;
+	node->proxy_first = node->proxy_count = 0;
+
+	return (int32_t)octree->nnodes++;
+}
+
+/**
+ * @brief This function returns octant of cell containing centroid
+ * of triangle
+ */
+static int triangle_octant(struct CTX *ctx, const uint32_t *triangle, const double *center)
+{
+	const mesh_real *coords[3] = {ctx->vx, ctx->vy, ctx->vz};
+	int k, octant = 0;
+
+	for(k = 0; k < 3; k++) {
+		double sum = (double)coords[k][triangle[0]] +
+				(double)coords[k][triangle[1]] +
+				(double)coords[k][triangle[2]];
+		if(sum > 3.0*center[k]) {
+			octant |= 1 << k;
+		}
+	}
+
+	return octant;
+}
+
+/**
+ * @brief This function builds subtree of triangles [first, first + count)
+ * lying in cell [min, max]. Triangles are sorted by octants of the cell
+ * with counting sort, so triangles of every child stay contiguous.
+ *
+ * @return Index of node or -1 on failure
+ */
+static int32_t octree_build_node(struct OctreeBuilder *builder,
+		uint64_t first,
+		uint64_t count,
+		const double *min,
+		const double *max,
+		int depth)
+{
+	struct Octree *octree = builder->octree;
+	struct CTX *ctx = builder->ctx;
+	uint32_t *triangles = &octree->triangles[3*first];
+	uint64_t sizes[8] = {0}, offsets[8], i, offset;
+	double center[3];
+	int32_t node_id;
+	int octant, k;
+
+	node_id = octree_node_add(octree);
+	if(node_id == -1) {
+		return -1;
+	}
+	octree->nodes[node_id].first = first;
+	octree->nodes[node_id].count = count;
+
+	/* Leaf node: compute bounding box of its triangles */
+	if(count <= OCTREE_LEAF_TRIANGLES || depth >= OCTREE_MAX_DEPTH) {
+		const mesh_real *coords[3] = {ctx->vx, ctx->vy, ctx->vz};
+		struct OctreeNode *node = &octree->nodes[node_id];
+
+		for(i = 0; i < 3*count; i++) {
+			for(k = 0; k < 3; k++) {
+				float value = (float)coords[k][triangles[i]];
+				if(value < node->min[k]) node->min[k] = value;
+				if(value > node->max[k]) node->max[k] = value;
+			}
+		}
+		return node_id;
+	}
+
+	for(k = 0; k < 3; k++) {
+		center[k] = 0.5*(min[k] + max[k]);
+	}
+
+	for(i = 0; i < count; i++) {
+		sizes[triangle_octant(ctx, &triangles[3*i], center)]++;
+	}
+
+	for(offset = 0, octant = 0; octant < 8; octant++) {
+		offsets[octant] = offset;
+		offset += sizes[octant];
+	}
+
+	for(i = 0; i < count; i++) {
+		octant = triangle_octant(ctx, &triangles[3*i], center);
+		memcpy(&builder->tmp[3*offsets[octant]], &triangles[3*i], 3*sizeof(uint32_t));
+		offsets[octant]++;
+	}
+	memcpy(triangles, builder->tmp, 3*count*sizeof(uint32_t));
+
+	for(offset = 0, octant = 0; octant < 8; octant++) {
+		double child_min[3], child_max[3];
+		int32_t child_id;
+
+		if(sizes[octant] == 0) {
+			continue;
+		}
+
+		for(k = 0; k < 3; k++) {
+			child_min[k] = (octant & (1 << k)) ? center[k] : min[k];
+			child_max[k] = (octant & (1 << k)) ? max[k] : center[k];
+		}
+
+		child_id = octree_build_node(builder, first + offset, sizes[octant],
+				child_min, child_max, depth + 1);
+		if(child_id == -1) {
+			return -1;
+		}
+
+		/* Array of nodes could be reallocated */
+		octree->nodes[node_id].children[octant] = child_id;
+		for(k = 0; k < 3; k++) {
+			if(octree->nodes[child_id].min[k] < octree->nodes[node_id].min[k])
+				octree->nodes[node_id].min[k] = octree->nodes[child_id].min[k];
+			if(octree->nodes[child_id].max[k] > octree->nodes[node_id].max[k])
+				octree->nodes[node_id].max[k] = octree->nodes[child_id].max[k];
+		}
+
+		offset += sizes[octant];
+	}
+
+	return node_id;
+}
+
+/**
+ * Grid of cells used for clustering of vertices. Cell is valid only, when
+ * its stamp is equal to current stamp, so the grid does not have to be
+ * cleared for every node.
+ */
+typedef struct ProxyGrid {
+	uint32_t vertices[OCTREE_PROXY_GRID*OCTREE_PROXY_GRID*OCTREE_PROXY_GRID];
+	uint32_t stamps[OCTREE_PROXY_GRID*OCTREE_PROXY_GRID*OCTREE_PROXY_GRID];
+	uint32_t stamp;
+} ProxyGrid;
+
+/**
+ * @brief This function returns 1, when node does not have any child
+ */
+static int octree_node_is_leaf(const struct OctreeNode *node)
+{
+	int i;
+
+	for(i = 0; i < 8; i++) {
+		if(node->children[i] != -1) return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function appends triangles to growing array
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int triangles_append(uint32_t **array,
+		uint64_t *count,
+		uint64_t *capacity,
+		const uint32_t *triangles,
+		uint64_t n)
+{
+	if(*count + n > *capacity) {
+		uint64_t new_capacity = 2*(*count + n);
+		uint32_t *tmp = (uint32_t*)realloc(*array, 3*new_capacity*sizeof(uint32_t));
+		if(tmp == NULL) {
+			return 0;
+		}
+		*array = tmp;
+		*capacity = new_capacity;
+	}
+
+	memcpy(&(*array)[3*(*count)], triangles, 3*n*sizeof(uint32_t));
+	*count += n;
+
+	return 1;
+}
+
+static int triangle_compare(const void *a, const void *b)
+{
+	const uint32_t *t1 = (const uint32_t*)a, *t2 = (const uint32_t*)b;
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		if(t1[i] != t2[i]) return (t1[i] < t2[i]) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief This function simplifies triangles of node by clustering of
+ * vertices. Bounding box of node is split to OCTREE_PROXY_GRID^3 cells and
+ * all vertices in one cell are replaced with the first vertex found in
+ * this cell, so the vertex buffer does not change. Degenerated and
+ * duplicated triangles are removed.
+ *
+ * @param triangles	The triangles of node, simplified triangles are
+ * written to the same buffer
+ * @return Number of simplified triangles
+ */
+static uint64_t cluster_triangles(struct CTX *ctx,
+		const struct OctreeNode *node,
+		struct ProxyGrid *grid,
+		uint32_t *triangles,
+		uint64_t count)
+{
+	const mesh_real *coords[3] = {ctx->vx, ctx->vy, ctx->vz};
+	uint64_t i, result = 0, unique = 0;
+	double scale[3];
+	int k, v;
+
+	grid->stamp++;
+
+	for(k = 0; k < 3; k++) {
+		double extent = node->max[k] - node->min[k];
+		scale[k] = (extent > 0.0) ? OCTREE_PROXY_GRID / extent : 0.0;
+	}
+
+	for(i = 0; i < count; i++) {
+		uint32_t tmp[3];
+
+		for(v = 0; v < 3; v++) {
+			uint32_t vertex = triangles[3*i + v], cell = 0;
+
+			for(k = 0; k < 3; k++) {
+				int c = (int)((coords[k][vertex] - node->min[k]) * scale[k]);
+				c = (c < 0) ? 0 : ((c >= OCTREE_PROXY_GRID) ? OCTREE_PROXY_GRID - 1 : c);
+				cell = cell * OCTREE_PROXY_GRID + c;
+			}
+			if(grid->stamps[cell] != grid->stamp) {
+				grid->stamps[cell] = grid->stamp;
+				grid->vertices[cell] = vertex;
+			}
+			tmp[v] = grid->vertices[cell];
+		}
+
+		if(tmp[0] == tmp[1] || tmp[1] == tmp[2] || tmp[0] == tmp[2]) {
+			continue;
+		}
+
+		/* Rotate triangle to start with the lowest index, it keeps orientation */
+		v = (tmp[0] < tmp[1]) ? ((tmp[0] < tmp[2]) ? 0 : 2) : ((tmp[1] < tmp[2]) ? 1 : 2);
+		for(k = 0; k < 3; k++) {
+			triangles[3*result + k] = tmp[(v + k) % 3];
+		}
+		result++;
+	}
+
+	qsort(triangles, result, 3*sizeof(uint32_t), triangle_compare);
+	for(i = 0; i < result; i++) {
+		if(unique == 0 || triangle_compare(&triangles[3*i], &triangles[3*(unique - 1)]) != 0) {
+			memmove(&triangles[3*unique], &triangles[3*i], 3*sizeof(uint32_t));
+			unique++;
+		}
+	}
+
+	return unique;
+}
+
+/**
+ * @brief This function creates coarse proxies of nodes. Nodes are
+ * processed from leaves to root and proxy of inner node is created from
+ * proxies of its children, so every triangle is clustered only once
+ * and each level of octree costs about the same time. Proxy is stored
+ * only, when it is smaller than node.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int octree_build_proxies(struct CTX *ctx, struct Octree *octree)
+{
+	struct ProxyGrid *grid;
+	uint32_t *input = NULL;
+	uint64_t input_capacity = 0, proxies_capacity = 0;
+	int64_t n;
+	int ret = 0;
+
+	grid = (struct ProxyGrid*)calloc(1, sizeof(struct ProxyGrid));
+	if(grid == NULL) {
+		return 0;
+	}
+
+	/* Children are always stored after their parent */
+	for(n = (int64_t)octree->nnodes - 1; n >= 0; n--) {
+		struct OctreeNode *node = &octree->nodes[n];
+		uint64_t count = 0;
+		int c;
+
+		if(node->count <= OCTREE_PROXY_TRIANGLES) {
+			continue;
+		}
+
+		/* Gather triangles of leaf or proxies of children */
+		if(octree_node_is_leaf(node) == 1) {
+			if(triangles_append(&input, &count, &input_capacity,
+					&octree->triangles[3*node->first], node->count) != 1) goto end;
+		} else {
+			for(c = 0; c < 8; c++) {
+				const struct OctreeNode *child;
+				int ok;
+
+				if(node->children[c] == -1) continue;
+				child = &octree->nodes[node->children[c]];
+				if(child->proxy_count > 0) {
+					ok = triangles_append(&input, &count, &input_capacity,
+							&octree->proxies[3*child->proxy_first], child->proxy_count);
+				} else {
+					ok = triangles_append(&input, &count, &input_capacity,
+							&octree->triangles[3*child->first], child->count);
+				}
+				if(ok != 1) goto end;
+			}
+		}
+
+		count = cluster_triangles(ctx, node, grid, input, count);
+		if(count == 0 || count >= node->count) {
+			continue;
+		}
+
+		node->proxy_first = octree->nproxies;
+		node->proxy_count = count;
+		if(triangles_append(&octree->proxies, &octree->nproxies, &proxies_capacity,
+				input, count) != 1) goto end;
+	}
+
+	ret = 1;
+end:
+	if(input != NULL) free(input);
+	free(grid);
+
+	return ret;
+}
+
+/**
+ * @brief This function builds octree of triangles of mesh. Quads are split
+ * to two triangles.
+ *
+ * @return Pointer at new octree or NULL on failure
+ */
+struct Octree *octree_build(struct CTX *ctx)
+{
+	struct OctreeBuilder builder;
+	struct Octree *octree;
+	struct BBox bbox;
+	uint64_t i, count = 0;
+
+	octree = (struct Octree*)calloc(1, sizeof(struct Octree));
+	if(octree == NULL) {
+		return NULL;
+	}
+
+	for(i = 0; i < ctx->nquads; i++) {
+		count += ctx->face_sizes[i] - 2;
+	}
+
+	octree->triangles = (uint32_t*)malloc(3 * count * sizeof(uint32_t));
+	builder.tmp = (uint32_t*)malloc(3 * count * sizeof(uint32_t));
+	if(count > 0 && (octree->triangles == NULL || builder.tmp == NULL)) {
+		if(builder.tmp != NULL) free(builder.tmp);
+		octree_free(octree);
+		return NULL;
+	}
+
+	for(i = 0; i < ctx->nquads; i++) {
+		const uint64_t *quad = &ctx->quads[4*i];
+		uint32_t *triangle = &octree->triangles[3*octree->ntriangles];
+
+		triangle[0] = (uint32_t)quad[0];
+		triangle[1] = (uint32_t)quad[1];
+		triangle[2] = (uint32_t)quad[2];
+		octree->ntriangles++;
+		if(ctx->face_sizes[i] == 4) {
+			triangle[3] = (uint32_t)quad[0];
+			triangle[4] = (uint32_t)quad[2];
+			triangle[5] = (uint32_t)quad[3];
+			octree->ntriangles++;
+		}
+	}
+
+	/* Root cell is bounding box of all vertices */
+	if(mesh_bbox(ctx, &bbox) != 1) {
+		free(builder.tmp);
+		octree_free(octree);
+		return NULL;
+	}
+
+	builder.ctx = ctx;
+	builder.octree = octree;
+
+	if(octree_build_node(&builder, 0, octree->ntriangles, bbox.min, bbox.max, 0) == -1 ||
+			octree_build_proxies(ctx, octree) != 1) {
+		free(builder.tmp);
+		octree_free(octree);
+		return NULL;
+	}
+
+	free(builder.tmp);
+
+	if(ctx->print_debug) {
+		printf("%s(): triangles: %lu, nodes: %u, proxy triangles: %lu\n",
+				__func__, (unsigned long)octree->ntriangles,
+				octree->nnodes, (unsigned long)octree->nproxies);
+	}
+
+	return octree;
+}
+
+/**
+ * @brief This function frees octree
+ */
+void octree_free(struct Octree *octree)
+{
+	if(octree == NULL) return;
+	if(octree->nodes != NULL) free(octree->nodes);
+	if(octree->triangles != NULL) free(octree->triangles);
+	if(octree->proxies != NULL) free(octree->proxies);
+	free(octree);
+}
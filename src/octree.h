@@ -0,0 +1,106 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#ifndef OCTREE_H_
+#define OCTREE_H_
+
+/* Maximal number of triangles in leaf node */
+#define OCTREE_LEAF_TRIANGLES 8192
+
+/* Nodes with fewer triangles do not have coarse proxy */
+#define OCTREE_PROXY_TRIANGLES 512
+
+/* Resolution of grid used for simplification of proxy of node */
+#define OCTREE_PROXY_GRID 16
+
+/* Maximal depth of octree */
+#define OCTREE_MAX_DEPTH 16
+
+struct CTX;
+
+/**
+ * Node of octree. Triangles of node and all its children are stored in
+ * one contiguous range of triangles.
+ */
+typedef struct OctreeNode {
+
+	/**
+	 * Bounding box of all triangles of node
+	 */
+	float min[3];
+	float max[3];
+
+	/**
+	 * Indexes of child nodes or -1
+	 */
+	int32_t children[8];
+
+	/**
+	 * Range of triangles of node and its children
+	 */
+	uint64_t first;
+	uint64_t count;
+
+	/**
+	 * Range of triangles of coarse proxy. It is empty, when node has
+	 * only few triangles and whole node is its own proxy.
+	 */
+	uint64_t proxy_first;
+	uint64_t proxy_count;
+} OctreeNode;
+
+/**
+ * Octree of triangles of mesh. Triangles are reordered, so triangles of
+ * every node can be drawn by one draw call.
+ */
+typedef struct Octree {
+
+	/**
+	 * Nodes of octree, the first node is root
+	 */
+	struct OctreeNode *nodes;
+	uint32_t nnodes;
+	uint32_t capacity;
+
+	/**
+	 * Three indices of vertices per triangle sorted by nodes
+	 */
+	uint32_t *triangles;
+	uint64_t ntriangles;
+
+	/**
+	 * Three indices of vertices per triangle of proxies
+	 */
+	uint32_t *proxies;
+	uint64_t nproxies;
+} Octree;
+
+struct Octree *octree_build(struct CTX *ctx);
+
+void octree_free(struct Octree *octree);
+
+#endif /* OCTREE_H_ */
@@ -0,0 +1,142 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "trace.h"
+#include "parallel.h"
+
+/**
+ * Range of items processed by one thread
+ */
+typedef struct ParallelJob {
+	pthread_t thread;
+	parallel_fn fn;
+	void *arg;
+	int thread_num;
+	uint64_t first;
+	uint64_t last;
+} ParallelJob;
+
+static void *parallel_job(void *arg)
+{
+	struct ParallelJob *job = (struct ParallelJob*)arg;
+	uint64_t start = trace_begin();
+
+	job->fn(job->arg, job->thread_num, job->first, job->last);
+
+	trace_end("parallel_job", "parallel", start, (int64_t)(job->last - job->first));
+
+	return NULL;
+}
+
+static void *parallel_thread(void *arg)
+{
+	trace_thread_name("worker");
+
+	return parallel_job(arg);
+}
+
+/**
+ * @brief This function returns number of threads used for processing of
+ * count items. When nthreads is zero, then number of online CPUs is used.
+ */
+int parallel_threads(int nthreads, uint64_t count)
+{
+	uint64_t max_threads;
+
+	if(nthreads <= 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpus > 0) ? (int)ncpus : 1;
+	}
+
+	max_threads = (count + PARALLEL_MIN_CHUNK - 1) / PARALLEL_MIN_CHUNK;
+	if(max_threads < 1) max_threads = 1;
+	if((uint64_t)nthreads > max_threads) nthreads = (int)max_threads;
+
+	return nthreads;
+}
+
+/**
+ * @brief This function splits count items to continuous ranges and it
+ * calls fn for each range in separate thread. The calling thread processes
+ * the first range. Ranges are aligned to 16 items, so vectorized kernels
+ * get aligned offsets. Number of threads has to be already resolved by
+ * parallel_threads(), because callers often allocate per-thread data.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int parallel_for(int nthreads, uint64_t count, parallel_fn fn, void *arg)
+{
+	struct ParallelJob *jobs;
+	uint64_t chunk;
+	int i, ret = 0;
+
+	if(nthreads <= 1 || count == 0) {
+		fn(arg, 0, 0, count);
+		return 0;
+	}
+
+	jobs = (struct ParallelJob*)calloc(nthreads, sizeof(struct ParallelJob));
+	if(jobs == NULL) {
+		return -1;
+	}
+
+	chunk = (count + nthreads - 1) / nthreads;
+	chunk = (chunk + 15) & ~(uint64_t)15;
+
+	for(i = 0; i < nthreads; i++) {
+		jobs[i].fn = fn;
+		jobs[i].arg = arg;
+		jobs[i].thread_num = i;
+		jobs[i].first = (i * chunk < count) ? i * chunk : count;
+		jobs[i].last = ((i + 1) * chunk < count) ? (i + 1) * chunk : count;
+	}
+
+	for(i = 1; i < nthreads; i++) {
+		if(pthread_create(&jobs[i].thread, NULL, parallel_thread, &jobs[i]) != 0) {
+			/* Process this range in calling thread */
+			jobs[i].thread = pthread_self();
+			parallel_job(&jobs[i]);
+		}
+	}
+
+	parallel_job(&jobs[0]);
+
+	for(i = 1; i < nthreads; i++) {
+		if(!pthread_equal(jobs[i].thread, pthread_self())) {
+			if(pthread_join(jobs[i].thread, NULL) != 0) {
+				ret = -1;
+			}
+		}
+	}
+
+	free(jobs);
+
+	return ret;
+}
@@ -0,0 +1,43 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+/* Minimal number of items processed by one thread */
+#define PARALLEL_MIN_CHUNK 4096
+
+/**
+ * Function processing range of items [first, last) in one thread
+ */
+typedef void (*parallel_fn)(void *arg, int thread_num, uint64_t first, uint64_t last);
+
+int parallel_threads(int nthreads, uint64_t count);
+
+int parallel_for(int nthreads, uint64_t count, parallel_fn fn, void *arg);
+
+#endif /* PARALLEL_H_ */
@@ -0,0 +1,343 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <verse.h>
+#include <rply.h>
+
+#include "main.h"
+#include "ply_loader.h"
+#include "ply_props.h"
+#include "quantize.h"
+#include "metrics.h"
+#include "trace.h"
+
+/**
+ * State of PLY loader shared by callback functions
+ */
+typedef struct PLYLoader {
+	struct CTX *ctx;
+	long vert_num;
+	long face_num;
+	/* Number of faces with more than four vertices */
+	long polygons;
+	/* Time, when first face was decoded */
+	uint64_t faces_start;
+} PLYLoader;
+
+/**
+ *
+ * @param argument
+ * @return
+ */
+static int vertex_cb(p_ply_argument argument)
+{
+	long xyz;
+	struct PLYLoader *loader;
+	struct CTX *ctx;
+	long *vert_num;
+
+	ply_get_argument_user_data(argument, (void**)&loader, &xyz);
+	ctx = loader->ctx;
+	vert_num = &loader->vert_num;
+
+	switch(xyz) {
+	case 0:
+		/* printf("%ld ", *vert_num); */
+		ctx->vx[*vert_num] = (mesh_real)ply_get_argument_value(argument);
+		break;
+	case 1:
+		ctx->vy[*vert_num] = (mesh_real)ply_get_argument_value(argument);
+		break;
+	case 2:
+		ctx->vz[*vert_num] = (mesh_real)ply_get_argument_value(argument);
+		if(ctx->print_debug) {
+			printf("(%g, %g, %g)\n",
+					(double)ctx->vx[*vert_num],
+					(double)ctx->vy[*vert_num],
+					(double)ctx->vz[*vert_num]);
+		}
+		*vert_num = *vert_num + 1;
+		break;
+	}
+	return 1;
+}
+
+/**
+ *
+ * @param argument
+ * @return
+ */
+static int face_cb(p_ply_argument argument)
+{
+	long length, value_index, *face_num;
+	struct PLYLoader *loader;
+	struct CTX *ctx;
+	static int size;
+	static long face_size = 0;
+
+	ply_get_argument_user_data(argument, (void**)&loader, NULL);
+	ply_get_argument_property(argument, NULL, &length, &value_index);
+	ctx = loader->ctx;
+	face_num = &loader->face_num;
+
+	/* Face without any index is stored as degenerated triangle */
+	if(value_index == -1 && length == 0) {
+		ctx->face_sizes[*face_num] = 3;
+		*face_num = *face_num + 1;
+		return 1;
+	}
+
+	/* When first index is loaded */
+	if(value_index == 0) {
+		face_size = length;
+		if(length > 4) {
+			loader->polygons++;
+		}
+		ctx->face_sizes[*face_num] = (uint8_t)((length < 3) ? 3 : ((length > 4) ? 4 : length));
+		size = (face_size < 4) ? 4 : face_size;
+		if(*face_num == 0) {
+			loader->faces_start = metrics_now();
+		}
+		if(ctx->print_debug) {
+			printf("%ld, %ld, ", *face_num, length);
+		}
+	}
+
+	/* Length of list is reported with value_index equal to -1 */
+	if(value_index >= 0 && value_index < 4) {
+		ctx->quads[4*(*face_num) + value_index] = (long)ply_get_argument_value(argument);
+	}
+
+	/* When last face index is loaded */
+	if(value_index >= 0 && value_index == (face_size - 1)) {
+		uint64_t *quad = &ctx->quads[4*(*face_num)];
+
+		/* Triangles are uploaded with the fourth index equal to zero, so
+		 * quad ending with vertex 0 is rotated to keep it distinguishable
+		 * from triangle. Rotation keeps winding of face. */
+		if(ctx->face_sizes[*face_num] == 4 && quad[3] == 0) {
+			uint64_t last = quad[3];
+			quad[3] = quad[2];
+			quad[2] = quad[1];
+			quad[1] = quad[0];
+			quad[0] = last;
+		}
+
+		if(ctx->print_debug) {
+			long i;
+			printf("{");
+			for(i = 0; i < size; i++) {
+				if(i != (size - 1)) {
+					printf("%ld, ", ctx->quads[4*(*face_num) + i]);
+				} else {
+					printf("%ld", ctx->quads[4*(*face_num) + i]);
+				}
+			}
+			printf("}\n");
+		}
+
+		*face_num = *face_num + 1;
+	}
+
+	return 1;
+}
+
+#ifdef WITH_SINGLE_PRECISION
+/**
+ * @brief This function returns 1, when coordinates of vertices are stored
+ * in PLY file as double precision numbers
+ */
+static int vertex_type_is_double(p_ply ply)
+{
+	p_ply_element element = NULL;
+	p_ply_property property = NULL;
+	const char *name;
+	e_ply_type type;
+
+	while((element = ply_get_next_element(ply, element)) != NULL) {
+		ply_get_element_info(element, &name, NULL);
+		if(strcmp(name, "vertex") != 0) continue;
+		while((property = ply_get_next_property(element, property)) != NULL) {
+			ply_get_property_info(property, &name, &type, NULL, NULL);
+			if(strcmp(name, "x") == 0) {
+				return (type == PLY_FLOAT64 || type == PLY_DOUBLE) ? 1 : 0;
+			}
+		}
+	}
+
+	return 0;
+}
+#endif
+
+/**
+ * @brief This function allocates arena containing coordinates of vertices,
+ * faces, extra vertex properties and buffers computed later (normals and
+ * quantized vertices), when they are requested.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int mesh_alloc(struct CTX *ctx)
+{
+	size_t coord_size = mesh_arena_size(ctx->nvertices * sizeof(mesh_real));
+	size_t quads_size = mesh_arena_size(4 * ctx->nquads * sizeof(uint64_t));
+	size_t sizes_size = mesh_arena_size(ctx->nquads * sizeof(uint8_t));
+	size_t size = 3*coord_size + quads_size + sizes_size;
+	int i;
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		size += mesh_arena_size(ctx->nvertices * ctx->prop_layers[i].item_size);
+	}
+
+	/* Reserve space for normals computed from faces */
+	if(ctx->compute_normals == 1 && ctx->nquads > 0 &&
+			ply_props_selected(ctx, "normal") == 1 &&
+			ply_props_find(ctx, LAYER_NORMALS_CT) == NULL) {
+		size += mesh_arena_size(ctx->nvertices * 3 * sizeof(float));
+	}
+
+	/* Reserve space for quantized vertices */
+	if(ctx->quant_bits > 0) {
+		size += mesh_arena_size(ctx->nvertices * quantization_item_size(ctx->quant_bits));
+	}
+
+	if(!mesh_arena_init(&ctx->arena, size)) {
+		return 0;
+	}
+
+	ctx->vx = (mesh_real*)mesh_arena_alloc(&ctx->arena, ctx->nvertices * sizeof(mesh_real));
+	ctx->vy = (mesh_real*)mesh_arena_alloc(&ctx->arena, ctx->nvertices * sizeof(mesh_real));
+	ctx->vz = (mesh_real*)mesh_arena_alloc(&ctx->arena, ctx->nvertices * sizeof(mesh_real));
+	ctx->quads = (uint64_t*)mesh_arena_alloc(&ctx->arena, 4 * ctx->nquads * sizeof(uint64_t));
+	ctx->face_sizes = (uint8_t*)mesh_arena_alloc(&ctx->arena, ctx->nquads * sizeof(uint8_t));
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		struct PropLayer *layer = &ctx->prop_layers[i];
+		layer->nitems = ctx->nvertices;
+		layer->data = mesh_arena_alloc(&ctx->arena, ctx->nvertices * layer->item_size);
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Load vertices, faces and extra vertex properties to the memory
+ *
+ * @param times	The durations of phases of loading or NULL. Vertices are
+ * expected to be stored before faces in PLY file.
+ * @return 1 on success, 0 on failure
+ */
+int load_ply_file(struct CTX *ctx, const char *my_filename, struct PLYLoadTimes *times)
+{
+	struct PLYLoader loader;
+	uint64_t t0, t1, t2, t3;
+	p_ply ply;
+
+	loader.ctx = ctx;
+	loader.vert_num = 0;
+	loader.face_num = 0;
+	loader.polygons = 0;
+	loader.faces_start = 0;
+
+	t0 = metrics_now();
+
+	ply = ply_open(my_filename, NULL, 0, NULL);
+
+	if (!ply) return 0;
+
+	if (!ply_read_header(ply)) {
+		printf("ERROR: Unable to read header of PLY file\n");
+		ply_close(ply);
+		return 0;
+	}
+
+	ctx->nvertices = ply_set_read_cb(ply, "vertex", "x", vertex_cb, &loader, 0);
+	ply_set_read_cb(ply, "vertex", "y", vertex_cb, &loader, 1);
+	ply_set_read_cb(ply, "vertex", "z", vertex_cb, &loader, 2);
+	ctx->nquads = ply_set_read_cb(ply, "face", "vertex_indices", face_cb, &loader, 0);
+
+	t1 = metrics_now();
+
+	/* Create layers for extra properties of vertices */
+	if(!ply_props_setup(ctx, ply)) {
+		printf("ERROR: Out of memory\n");
+		ply_close(ply);
+		return 0;
+	}
+
+	/* Allocate all buffers of mesh in one block of memory */
+	if(!mesh_alloc(ctx)) {
+		printf("ERROR: Out of memory\n");
+		ply_close(ply);
+		return 0;
+	}
+
+#ifdef WITH_SINGLE_PRECISION
+	if(vertex_type_is_double(ply)) {
+		printf("WARNING: Coordinates are stored in memory as float, rebuild without WITH_SINGLE_PRECISION to keep double precision\n");
+	}
+#endif
+
+	printf("vertices: %ld, faces: %ld\n", ctx->nvertices, ctx->nquads);
+
+	t2 = metrics_now();
+
+	/* Load whole file to memory. Items, that were not decoded, would stay
+	 * zero, so truncated file is not accepted. */
+	if (!ply_read(ply) || (uint64_t)loader.vert_num != ctx->nvertices ||
+			(uint64_t)loader.face_num != ctx->nquads) {
+		printf("ERROR: PLY file is truncated or corrupted, decoded vertices: %ld/%ld, faces: %ld/%ld\n",
+				loader.vert_num, (long)ctx->nvertices, loader.face_num, (long)ctx->nquads);
+		ply_close(ply);
+		return 0;
+	}
+
+	ply_close(ply);
+
+	if(loader.polygons > 0) {
+		printf("WARNING: %ld faces with more than 4 vertices were truncated to quads\n",
+				loader.polygons);
+	}
+
+	t3 = metrics_now();
+	if(loader.faces_start == 0) {
+		loader.faces_start = t3;
+	}
+
+	if(times != NULL) {
+		times->header = (t1 - t0) * 1e-9;
+		times->alloc = (t2 - t1) * 1e-9;
+		times->vertices = (loader.faces_start - t2) * 1e-9;
+		times->faces = (t3 - loader.faces_start) * 1e-9;
+	}
+
+	trace_span("header", "load", t0, t1, -1);
+	trace_span("alloc", "load", t1, t2, -1);
+	trace_span("vertices", "load", t2, loader.faces_start, ctx->nvertices);
+	trace_span("faces", "load", loader.faces_start, t3, ctx->nquads);
+
+	return 1;
+}
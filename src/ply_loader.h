@@ -0,0 +1,46 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#ifndef PLY_LOADER_H_
+#define PLY_LOADER_H_
+
+struct CTX;
+
+/**
+ * Durations of phases of loading of PLY file in seconds
+ */
+typedef struct PLYLoadTimes {
+	/* Opening of file and parsing of header */
+	double header;
+	/* Setup of property layers and allocation of buffers */
+	double alloc;
+	/* Decoding of vertices and their properties */
+	double vertices;
+	/* Decoding of faces */
+	double faces;
+} PLYLoadTimes;
+
+int load_ply_file(struct CTX *ctx, const char *my_filename, struct PLYLoadTimes *times);
+
+#endif /* PLY_LOADER_H_ */
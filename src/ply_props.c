@@ -0,0 +1,486 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <verse.h>
+#include <rply.h>
+
+#include "main.h"
+#include "ply_props.h"
+
+/**
+ * Group of PLY properties stored in one Verse layer
+ */
+typedef struct PropGroup {
+	const char *name;
+	uint16_t custom_type;
+	const char *prop_names[MAX_LAYER_PROPS];
+} PropGroup;
+
+/* Known groups of vertex properties. Groups with more properties have to
+ * be listed before groups with the same name and less properties. */
+static const PropGroup known_groups[] = {
+	{"normal", LAYER_NORMALS_CT, {"nx", "ny", "nz", NULL}},
+	{"normal", LAYER_NORMALS_CT, {"normal_x", "normal_y", "normal_z", NULL}},
+	{"color", LAYER_COLORS_CT, {"red", "green", "blue", "alpha"}},
+	{"color", LAYER_COLORS_CT, {"red", "green", "blue", NULL}},
+	{"color", LAYER_COLORS_CT, {"diffuse_red", "diffuse_green", "diffuse_blue", "diffuse_alpha"}},
+	{"color", LAYER_COLORS_CT, {"diffuse_red", "diffuse_green", "diffuse_blue", NULL}},
+	{"color", LAYER_COLORS_CT, {"r", "g", "b", "a"}},
+	{"color", LAYER_COLORS_CT, {"r", "g", "b", NULL}},
+	{"uv", LAYER_UVS_CT, {"u", "v", NULL, NULL}},
+	{"uv", LAYER_UVS_CT, {"s", "t", NULL, NULL}},
+	{"uv", LAYER_UVS_CT, {"texture_u", "texture_v", NULL, NULL}},
+	{"confidence", LAYER_CONFIDENCE_CT, {"confidence", NULL, NULL, NULL}},
+	{"intensity", LAYER_INTENSITY_CT, {"intensity", NULL, NULL, NULL}},
+	{NULL, 0, {NULL, NULL, NULL, NULL}}
+};
+
+/**
+ * Scalar vertex property found in header of PLY file
+ */
+typedef struct PropInfo {
+	const char *name;
+	e_ply_type type;
+	int claimed;
+} PropInfo;
+
+static void store_uint8(void *data, uint64_t index, double value)
+{
+	((uint8_t*)data)[index] = (uint8_t)value;
+}
+
+static void store_uint16(void *data, uint64_t index, double value)
+{
+	((uint16_t*)data)[index] = (uint16_t)value;
+}
+
+static void store_uint32(void *data, uint64_t index, double value)
+{
+	((uint32_t*)data)[index] = (uint32_t)value;
+}
+
+static void store_real32(void *data, uint64_t index, double value)
+{
+	((float*)data)[index] = (float)value;
+}
+
+static void store_real64(void *data, uint64_t index, double value)
+{
+	((double*)data)[index] = value;
+}
+
+/**
+ * @brief This function returns size of Verse value type in bytes
+ */
+size_t value_type_size(uint8_t data_type)
+{
+	switch(data_type) {
+	case VRS_VALUE_TYPE_UINT8:
+		return 1;
+	case VRS_VALUE_TYPE_UINT16:
+	case VRS_VALUE_TYPE_REAL16:
+		return 2;
+	case VRS_VALUE_TYPE_UINT32:
+	case VRS_VALUE_TYPE_REAL32:
+		return 4;
+	case VRS_VALUE_TYPE_UINT64:
+	case VRS_VALUE_TYPE_REAL64:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief This function returns the narrowest Verse value type able to
+ * represent all values of PLY type. Verse does not have signed integer
+ * types, so signed PLY types are stored as real numbers.
+ */
+static uint8_t ply_type_to_value_type(e_ply_type type)
+{
+	switch(type) {
+	case PLY_UINT8:
+	case PLY_UCHAR:
+		return VRS_VALUE_TYPE_UINT8;
+	case PLY_UINT16:
+	case PLY_USHORT:
+		return VRS_VALUE_TYPE_UINT16;
+	case PLY_UIN32:
+	case PLY_UINT:
+		return VRS_VALUE_TYPE_UINT32;
+	case PLY_INT8:
+	case PLY_CHAR:
+	case PLY_INT16:
+	case PLY_SHORT:
+	case PLY_FLOAT32:
+	case PLY_FLOAT:
+		return VRS_VALUE_TYPE_REAL32;
+	default:
+		return VRS_VALUE_TYPE_REAL64;
+	}
+}
+
+/**
+ * @brief This function returns the narrowest Verse value type able to
+ * represent values of both types
+ */
+static uint8_t merge_value_types(uint8_t type1, uint8_t type2)
+{
+	int is_real1 = (type1 >= VRS_VALUE_TYPE_REAL16);
+	int is_real2 = (type2 >= VRS_VALUE_TYPE_REAL16);
+
+	if(is_real1 == is_real2) {
+		return (type1 > type2) ? type1 : type2;
+	}
+
+	/* Mix of unsigned integer and real type; REAL32 represents exactly
+	 * integers up to 24 bits only. */
+	if(is_real1 == 0) {
+		uint8_t tmp = type1;
+		type1 = type2;
+		type2 = tmp;
+	}
+	if(type2 >= VRS_VALUE_TYPE_UINT32 && type1 < VRS_VALUE_TYPE_REAL64) {
+		return VRS_VALUE_TYPE_REAL64;
+	}
+	return (type1 < VRS_VALUE_TYPE_REAL32) ? VRS_VALUE_TYPE_REAL32 : type1;
+}
+
+static prop_store_fn value_type_store_fn(uint8_t data_type)
+{
+	switch(data_type) {
+	case VRS_VALUE_TYPE_UINT8:
+		return store_uint8;
+	case VRS_VALUE_TYPE_UINT16:
+		return store_uint16;
+	case VRS_VALUE_TYPE_UINT32:
+		return store_uint32;
+	case VRS_VALUE_TYPE_REAL32:
+		return store_real32;
+	default:
+		return store_real64;
+	}
+}
+
+/**
+ * @brief This function returns 1, when layer or one of its properties was
+ * selected by user for uploading
+ */
+static int is_selected(const char *selection, const char *layer_name,
+		const char * const *prop_names, int count)
+{
+	const char *begin = selection, *end;
+	size_t len;
+	int i;
+
+	/* All properties are uploaded by default */
+	if(selection == NULL) return 1;
+
+	while(*begin != '\0') {
+		end = strchr(begin, ',');
+		len = (end != NULL) ? (size_t)(end - begin) : strlen(begin);
+		if(strlen(layer_name) == len && strncmp(begin, layer_name, len) == 0) {
+			return 1;
+		}
+		for(i = 0; i < count; i++) {
+			if(strlen(prop_names[i]) == len && strncmp(begin, prop_names[i], len) == 0) {
+				return 1;
+			}
+		}
+		if(end == NULL) break;
+		begin = end + 1;
+	}
+
+	return 0;
+}
+
+static PropInfo *find_prop(PropInfo *props, int nprops, const char *name)
+{
+	int i;
+
+	for(i = 0; i < nprops; i++) {
+		if(props[i].claimed == 0 && strcmp(props[i].name, name) == 0) {
+			return &props[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Callback function storing one value of extra vertex property
+ *
+ * The store function and the offset of value in the item are resolved
+ * from PLY header once, when layer is created. Decoding of each value
+ * is then only a store to the row of vertex in the layer buffer.
+ */
+static int prop_cb(p_ply_argument argument)
+{
+	struct PropLayer *layer;
+	long prop_index, vert_index;
+
+	ply_get_argument_user_data(argument, (void**)&layer, &prop_index);
+	ply_get_argument_element(argument, NULL, &vert_index);
+
+	layer->store(layer->data,
+			(uint64_t)vert_index * layer->count + prop_index,
+			ply_get_argument_value(argument));
+
+	return 1;
+}
+
+/**
+ * @brief This function adds new layer for group of PLY properties
+ */
+static struct PropLayer *add_layer(struct CTX *ctx,
+		const char *name,
+		uint16_t custom_type,
+		PropInfo **props,
+		int count)
+{
+	struct PropLayer *layer;
+	uint8_t data_type;
+	int i;
+
+	if(ctx->nprop_layers >= MAX_PROP_LAYERS) {
+		printf("WARNING: Too many vertex properties, skipping: %s\n", name);
+		return NULL;
+	}
+
+	layer = &ctx->prop_layers[ctx->nprop_layers];
+	memset(layer, 0, sizeof(struct PropLayer));
+
+	strncpy(layer->name, name, MAX_PROP_NAME_LEN - 1);
+	data_type = ply_type_to_value_type(props[0]->type);
+	for(i = 0; i < count; i++) {
+		strncpy(layer->prop_names[i], props[i]->name, MAX_PROP_NAME_LEN - 1);
+		data_type = merge_value_types(data_type, ply_type_to_value_type(props[i]->type));
+		props[i]->claimed = 1;
+	}
+
+	layer->custom_type = custom_type;
+	layer->data_type = data_type;
+	layer->count = (uint8_t)count;
+	layer->item_size = count * value_type_size(data_type);
+	layer->layer_id = -1;
+	layer->store = value_type_store_fn(data_type);
+
+	ctx->nprop_layers++;
+
+	return layer;
+}
+
+/**
+ * @brief This function inspects header of PLY file and it creates layer
+ * for each selected extra property of vertices. Properties, that belong
+ * together (normals, colors, texture coordinates), are stored in one layer.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int ply_props_setup(struct CTX *ctx, p_ply ply)
+{
+	PropInfo props[MAX_PROP_LAYERS * MAX_LAYER_PROPS];
+	PropInfo *group_props[MAX_LAYER_PROPS];
+	p_ply_element element = NULL;
+	p_ply_property property = NULL;
+	const char *name;
+	e_ply_type type;
+	int nprops = 0, i, j;
+	uint16_t next_custom_type = LAYER_PROPERTY_CT;
+
+	ctx->nprop_layers = 0;
+	ctx->prop_layers = (struct PropLayer*)calloc(MAX_PROP_LAYERS, sizeof(struct PropLayer));
+	if(ctx->prop_layers == NULL) {
+		return 0;
+	}
+
+	/* Find element containing vertices */
+	while((element = ply_get_next_element(ply, element)) != NULL) {
+		ply_get_element_info(element, &name, NULL);
+		if(strcmp(name, "vertex") == 0) break;
+	}
+	if(element == NULL) {
+		return 1;
+	}
+
+	/* Collect scalar properties of vertices except coordinates */
+	while((property = ply_get_next_property(element, property)) != NULL) {
+		ply_get_property_info(property, &name, &type, NULL, NULL);
+		if(type == PLY_LIST ||
+				strcmp(name, "x") == 0 ||
+				strcmp(name, "y") == 0 ||
+				strcmp(name, "z") == 0) {
+			continue;
+		}
+		if(nprops < MAX_PROP_LAYERS * MAX_LAYER_PROPS) {
+			props[nprops].name = name;
+			props[nprops].type = type;
+			props[nprops].claimed = 0;
+			nprops++;
+		}
+	}
+
+	/* Try to match known groups of properties */
+	for(i = 0; known_groups[i].name != NULL; i++) {
+		const PropGroup *group = &known_groups[i];
+		int count = 0;
+
+		for(j = 0; j < MAX_LAYER_PROPS && group->prop_names[j] != NULL; j++) {
+			group_props[j] = find_prop(props, nprops, group->prop_names[j]);
+			if(group_props[j] == NULL) break;
+			count++;
+		}
+		if(j < MAX_LAYER_PROPS && group->prop_names[j] != NULL) {
+			continue;
+		}
+
+		if(ply_props_find(ctx, group->custom_type) != NULL) {
+			continue;
+		}
+
+		if(is_selected(ctx->my_props, group->name, group->prop_names, count)) {
+			add_layer(ctx, group->name, group->custom_type, group_props, count);
+		} else {
+			for(j = 0; j < count; j++) group_props[j]->claimed = 1;
+		}
+	}
+
+	/* Each remaining property is stored in its own layer */
+	for(i = 0; i < nprops; i++) {
+		if(props[i].claimed != 0) continue;
+		group_props[0] = &props[i];
+		if(is_selected(ctx->my_props, props[i].name, &props[i].name, 1)) {
+			if(add_layer(ctx, props[i].name, next_custom_type, group_props, 1) != NULL) {
+				next_custom_type++;
+			}
+		}
+	}
+
+	/* Register callback functions. Buffers of layers are allocated
+	 * by loader together with other buffers of mesh. */
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		struct PropLayer *layer = &ctx->prop_layers[i];
+
+		for(j = 0; j < layer->count; j++) {
+			ply_set_read_cb(ply, "vertex", layer->prop_names[j], prop_cb, layer, j);
+		}
+
+		printf("layer: %s, type: %d, count: %d\n",
+				layer->name, layer->data_type, layer->count);
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function returns 1, when layer with given name was selected
+ * by user for uploading (e.g. normals computed from faces)
+ */
+int ply_props_selected(struct CTX *ctx, const char *name)
+{
+	return is_selected(ctx->my_props, name, NULL, 0);
+}
+
+/**
+ * @brief This function adds layer for properties, that were not loaded
+ * from PLY file, but computed from mesh (e.g. vertex normals or bounds
+ * of meshlets). Buffer is taken from arena of mesh, when loader reserved
+ * space for it.
+ *
+ * @return Pointer at new layer with allocated data or NULL
+ */
+struct PropLayer *ply_props_add(struct CTX *ctx,
+		const char *name,
+		uint16_t custom_type,
+		uint8_t data_type,
+		uint8_t count,
+		uint64_t nitems)
+{
+	struct PropLayer *layer;
+
+	if(ctx->prop_layers == NULL || ctx->nprop_layers >= MAX_PROP_LAYERS) {
+		return NULL;
+	}
+
+	layer = &ctx->prop_layers[ctx->nprop_layers];
+	memset(layer, 0, sizeof(struct PropLayer));
+
+	strncpy(layer->name, name, MAX_PROP_NAME_LEN - 1);
+	layer->custom_type = custom_type;
+	layer->data_type = data_type;
+	layer->count = count;
+	layer->item_size = count * value_type_size(data_type);
+	layer->layer_id = -1;
+	layer->store = value_type_store_fn(data_type);
+	layer->nitems = nitems;
+	layer->data = mesh_arena_alloc(&ctx->arena, nitems * layer->item_size);
+	if(layer->data == NULL) {
+		layer->data = calloc(nitems, layer->item_size);
+	}
+
+	if(layer->data == NULL && nitems > 0) {
+		return NULL;
+	}
+
+	ctx->nprop_layers++;
+
+	return layer;
+}
+
+/**
+ * @brief This function tries to find layer with extra vertex properties
+ */
+struct PropLayer *ply_props_find(struct CTX *ctx, uint16_t custom_type)
+{
+	int i;
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		if(ctx->prop_layers[i].custom_type == custom_type) {
+			return &ctx->prop_layers[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief This function frees all layers with extra vertex properties
+ */
+void ply_props_clear(struct CTX *ctx)
+{
+	int i;
+
+	if(ctx->prop_layers == NULL) return;
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		void *data = ctx->prop_layers[i].data;
+		if(data != NULL && mesh_arena_owns(&ctx->arena, data) == 0) free(data);
+	}
+	free(ctx->prop_layers);
+	ctx->prop_layers = NULL;
+	ctx->nprop_layers = 0;
+}
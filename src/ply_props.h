@@ -0,0 +1,121 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rply.h>
+
+#ifndef PLY_PROPS_H_
+#define PLY_PROPS_H_
+
+/* Maximal number of PLY properties stored in one item of Verse layer */
+#define MAX_LAYER_PROPS 4
+
+/* Maximal length of name of PLY property or layer */
+#define MAX_PROP_NAME_LEN 32
+
+/* Maximal number of layers with extra vertex properties */
+#define MAX_PROP_LAYERS 32
+
+struct CTX;
+
+/**
+ * Function storing one decoded value to the buffer of layer
+ */
+typedef void (*prop_store_fn)(void *data, uint64_t index, double value);
+
+/**
+ * Layer containing extra vertex properties loaded from PLY file
+ */
+typedef struct PropLayer {
+
+	/**
+	 * Name of layer (group name like "color" or name of PLY property)
+	 */
+	char name[MAX_PROP_NAME_LEN];
+
+	/**
+	 * Names of PLY properties stored in one item of this layer
+	 */
+	char prop_names[MAX_LAYER_PROPS][MAX_PROP_NAME_LEN];
+
+	/**
+	 * Custom type of Verse layer
+	 */
+	uint16_t custom_type;
+
+	/**
+	 * Verse value type of this layer
+	 */
+	uint8_t data_type;
+
+	/**
+	 * Number of values in one item
+	 */
+	uint8_t count;
+
+	/**
+	 * Size of one item in bytes
+	 */
+	size_t item_size;
+
+	/**
+	 * ID of Verse layer
+	 */
+	int64_t layer_id;
+
+	/**
+	 * Function converting value from PLY to data_type
+	 */
+	prop_store_fn store;
+
+	/**
+	 * Number of items (vertices or meshlets)
+	 */
+	uint64_t nitems;
+
+	/**
+	 * Array of items (one item per vertex or meshlet)
+	 */
+	void *data;
+} PropLayer;
+
+size_t value_type_size(uint8_t data_type);
+
+int ply_props_setup(struct CTX *ctx, p_ply ply);
+
+struct PropLayer *ply_props_add(struct CTX *ctx,
+		const char *name,
+		uint16_t custom_type,
+		uint8_t data_type,
+		uint8_t count,
+		uint64_t nitems);
+
+int ply_props_selected(struct CTX *ctx, const char *name);
+
+struct PropLayer *ply_props_find(struct CTX *ctx, uint16_t custom_type);
+
+void ply_props_clear(struct CTX *ctx);
+
+#endif /* PLY_PROPS_H_ */
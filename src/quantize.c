@@ -0,0 +1,277 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <verse.h>
+
+#include "main.h"
+#include "simd.h"
+#include "parallel.h"
+#include "bbox.h"
+#include "quantize.h"
+
+/* Adding and subtracting this number rounds double to integer (1.5 * 2^52) */
+#define QUANT_ROUND_MAGIC 6755399441055744.0
+
+/**
+ * Data shared by threads quantizing vertices
+ */
+typedef struct QuantJob {
+	const mesh_real *coords[3];
+	struct Quantization *quant;
+	double min[3];
+	double scale[3];
+	double step[3];
+	double max_q;
+	/* Per-thread maximal errors */
+	double *errors;
+} QuantJob;
+
+/**
+ * @brief This function stores one quantized coordinate
+ */
+static inline void quantize_store(struct Quantization *quant, uint64_t i, int axis, uint32_t q)
+{
+	if(quant->bits <= QUANT_MAX_BITS_UINT16) {
+		((uint16_t*)quant->data)[3*i + axis] = (uint16_t)q;
+	} else {
+		((uint64_t*)quant->data)[i] |= (uint64_t)q << (axis*QUANT_MAX_BITS);
+	}
+}
+
+/**
+ * @brief This function quantizes vertices [first, last)
+ *
+ * Each axis is quantized in separate pass over its array of coordinates.
+ * Coordinates are scaled, clamped and rounded to the nearest integer by
+ * SIMD_WIDTH values at once: adding and subtracting QUANT_ROUND_MAGIC
+ * rounds value in current rounding mode (to nearest even), like
+ * nearbyint() used for remaining vertices. Float vectors are not precise
+ * enough for 21 bits, so vertices stored as float are quantized in double
+ * by the scalar loop. Quantized coordinates are decoded back to measure
+ * real maximal error.
+ */
+static void quantize_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct QuantJob *job = (struct QuantJob*)arg;
+	struct Quantization *quant = job->quant;
+	double *error = &job->errors[3*thread_num];
+	int axis;
+
+	for(axis = 0; axis < 3; axis++) {
+		const mesh_real *coords = job->coords[axis];
+		const double min = job->min[axis];
+		const double scale = job->scale[axis];
+		const double step = job->step[axis];
+		const double max_q = job->max_q;
+		double max_err = 0.0;
+		uint64_t i = first;
+
+#if defined(WITH_SIMD) && !defined(WITH_SINGLE_PRECISION)
+		{
+			const simd_real vmin = simd_set1((mesh_real)min);
+			const simd_real vscale = simd_set1((mesh_real)scale);
+			const simd_real vstep = simd_set1((mesh_real)step);
+			const simd_real vmax_q = simd_set1((mesh_real)max_q);
+			const simd_real zero = simd_set1(0.0);
+			const simd_real magic = simd_set1(QUANT_ROUND_MAGIC);
+			simd_real verr = zero;
+			mesh_real lanes[SIMD_WIDTH];
+			int k;
+
+			for(; i + SIMD_WIDTH <= last; i += SIMD_WIDTH) {
+				simd_real c = simd_load(&coords[i]);
+				simd_real q = simd_mul(simd_sub(c, vmin), vscale);
+				simd_real d;
+
+				q = simd_min(simd_max(q, zero), vmax_q);
+				q = simd_sub(simd_add(q, magic), magic);
+				d = simd_sub(c, simd_add(simd_mul(q, vstep), vmin));
+				verr = simd_max(verr, simd_max(d, simd_sub(zero, d)));
+
+				simd_store(lanes, q);
+				for(k = 0; k < SIMD_WIDTH; k++) {
+					quantize_store(quant, i + k, axis, (uint32_t)lanes[k]);
+				}
+			}
+
+			simd_store(lanes, verr);
+			for(k = 0; k < SIMD_WIDTH; k++) {
+				max_err = (lanes[k] > max_err) ? lanes[k] : max_err;
+			}
+		}
+#endif
+
+		for(; i < last; i++) {
+			double value = (coords[i] - min) * scale;
+			uint32_t q = (uint32_t)nearbyint((value < 0.0) ? 0.0 : ((value < max_q) ? value : max_q));
+			double err = fabs(coords[i] - (q * step + min));
+			max_err = (err > max_err) ? err : max_err;
+			quantize_store(quant, i, axis, q);
+		}
+
+		error[axis] = max_err;
+	}
+}
+
+/**
+ * @brief This function returns size of one quantized vertex in bytes
+ */
+size_t quantization_item_size(int bits)
+{
+	return (bits <= QUANT_MAX_BITS_UINT16) ? 3*sizeof(uint16_t) : sizeof(uint64_t);
+}
+
+/**
+ * @brief This function quantizes vertices of mesh to integers relative
+ * to bounding box of mesh.
+ *
+ * @param bits	The number of bits of one coordinate (1 - QUANT_MAX_BITS)
+ * @return Pointer at quantized vertices or NULL on failure
+ */
+struct Quantization *quantize_vertices(struct CTX *ctx, int bits)
+{
+	struct Quantization *quant;
+	struct QuantJob job;
+	int nthreads, t, k;
+
+	if(bits < 1 || bits > QUANT_MAX_BITS) {
+		printf("ERROR: Number of quantization bits has to be in range 1 - %d\n",
+				QUANT_MAX_BITS);
+		return NULL;
+	}
+
+	quant = (struct Quantization*)calloc(1, sizeof(struct Quantization));
+	if(quant == NULL) {
+		return NULL;
+	}
+
+	quant->bits = bits;
+	quant->item_size = quantization_item_size(bits);
+	if(bits <= QUANT_MAX_BITS_UINT16) {
+		quant->data_type = VRS_VALUE_TYPE_UINT16;
+		quant->count = 3;
+	} else {
+		quant->data_type = VRS_VALUE_TYPE_UINT64;
+		quant->count = 1;
+	}
+
+	if(mesh_bbox(ctx, &quant->bbox) != 1) {
+		quantization_free(quant, &ctx->arena);
+		return NULL;
+	}
+
+	/* Use space reserved in arena by loader, when it is available */
+	quant->data = mesh_arena_alloc(&ctx->arena, ctx->nvertices * quant->item_size);
+	if(quant->data == NULL) {
+		quant->data = calloc(ctx->nvertices, quant->item_size);
+	}
+	nthreads = parallel_threads(ctx->nthreads, ctx->nvertices);
+	job.errors = (double*)calloc(3*nthreads, sizeof(double));
+	if((quant->data == NULL && ctx->nvertices > 0) || job.errors == NULL) {
+		if(job.errors != NULL) free(job.errors);
+		quantization_free(quant, &ctx->arena);
+		return NULL;
+	}
+
+	job.coords[0] = ctx->vx;
+	job.coords[1] = ctx->vy;
+	job.coords[2] = ctx->vz;
+	job.quant = quant;
+	job.max_q = (double)((1UL << bits) - 1);
+	for(k = 0; k < 3; k++) {
+		double extent = quant->bbox.max[k] - quant->bbox.min[k];
+		job.min[k] = quant->bbox.min[k];
+		job.scale[k] = (extent > 0.0) ? job.max_q / extent : 0.0;
+		job.step[k] = extent / job.max_q;
+	}
+
+	if(parallel_for(nthreads, ctx->nvertices, quantize_range, &job) != 0) {
+		free(job.errors);
+		quantization_free(quant, &ctx->arena);
+		return NULL;
+	}
+
+	for(t = 0; t < nthreads; t++) {
+		for(k = 0; k < 3; k++) {
+			if(job.errors[3*t + k] > quant->max_error[k]) {
+				quant->max_error[k] = job.errors[3*t + k];
+			}
+		}
+	}
+	free(job.errors);
+
+	printf("quantization: bits: %d, bbox: (%g, %g, %g) - (%g, %g, %g), max error: (%g, %g, %g)\n",
+			bits,
+			quant->bbox.min[0], quant->bbox.min[1], quant->bbox.min[2],
+			quant->bbox.max[0], quant->bbox.max[1], quant->bbox.max[2],
+			quant->max_error[0], quant->max_error[1], quant->max_error[2]);
+
+	return quant;
+}
+
+/**
+ * @brief This function decodes one quantized vertex
+ *
+ * @param item	The item of vertex layer (quant->item_size bytes)
+ * @param vertex	The decoded coordinates
+ */
+void quantization_decode(const struct Quantization *quant, const void *item, double *vertex)
+{
+	const double max_q = (double)((1UL << quant->bits) - 1);
+	uint64_t packed = 0;
+	int k;
+
+	if(quant->bits > QUANT_MAX_BITS_UINT16) {
+		memcpy(&packed, item, sizeof(uint64_t));
+	}
+
+	for(k = 0; k < 3; k++) {
+		double step = (quant->bbox.max[k] - quant->bbox.min[k]) / max_q;
+		uint32_t q;
+
+		if(quant->bits <= QUANT_MAX_BITS_UINT16) {
+			uint16_t value;
+			memcpy(&value, (const char*)item + k*sizeof(uint16_t), sizeof(uint16_t));
+			q = value;
+		} else {
+			q = (uint32_t)((packed >> (k*QUANT_MAX_BITS)) & ((1UL << QUANT_MAX_BITS) - 1));
+		}
+
+		vertex[k] = quant->bbox.min[k] + q * step;
+	}
+}
+
+/**
+ * @brief This function frees quantized vertices
+ */
+void quantization_free(struct Quantization *quant, struct MeshArena *arena)
+{
+	if(quant == NULL) return;
+	if(quant->data != NULL && mesh_arena_owns(arena, quant->data) == 0) free(quant->data);
+	free(quant);
+}
@@ -0,0 +1,95 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bbox.h"
+#include "mesh.h"
+
+#ifndef QUANTIZE_H_
+#define QUANTIZE_H_
+
+/* Maximal number of bits of one quantized coordinate */
+#define QUANT_MAX_BITS 21
+
+/* Maximal number of bits stored as three UINT16 values */
+#define QUANT_MAX_BITS_UINT16 16
+
+struct CTX;
+
+/**
+ * Vertices quantized relative to bounding box of mesh. Coordinate is
+ * decoded as: min + q * (max - min) / (2^bits - 1). Coordinates with
+ * up to 16 bits are stored as UINT16 x3, coordinates with up to 21 bits
+ * are packed to one UINT64 as: x | y << 21 | z << 42.
+ */
+typedef struct Quantization {
+
+	/**
+	 * Number of bits of one coordinate
+	 */
+	int bits;
+
+	/**
+	 * Bounding box of mesh
+	 */
+	struct BBox bbox;
+
+	/**
+	 * Measured maximal error of coordinates
+	 */
+	double max_error[3];
+
+	/**
+	 * Verse value type of vertex layer
+	 */
+	uint8_t data_type;
+
+	/**
+	 * Number of values in one item of vertex layer
+	 */
+	uint8_t count;
+
+	/**
+	 * Size of one item in bytes
+	 */
+	size_t item_size;
+
+	/**
+	 * Array of quantized vertices
+	 */
+	void *data;
+} Quantization;
+
+size_t quantization_item_size(int bits);
+
+struct Quantization *quantize_vertices(struct CTX *ctx, int bits);
+
+void quantization_decode(const struct Quantization *quant, const void *item, double *vertex);
+
+void quantization_free(struct Quantization *quant, struct MeshArena *arena);
+
+#endif /* QUANTIZE_H_ */
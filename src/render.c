@@ -0,0 +1,1083 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <verse.h>
+
+/* Buffer objects are core since OpenGL 1.5 */
+#define GL_GLEXT_PROTOTYPES
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include "main.h"
+#include "bbox.h"
+#include "ply_props.h"
+#include "quantize.h"
+#include "spsc_queue.h"
+#include "octree.h"
+#include "trace.h"
+#include "render.h"
+
+/* Maximal number of indices drawn by one call of glDrawElements() */
+#define RENDER_MAX_DRAW_INDICES	(1 << 30)
+
+/* Limits of projected size of node, when its proxy is drawn */
+#define RENDER_LOD_MIN_PIXELS	1.0
+#define RENDER_LOD_MAX_PIXELS	1.0e6
+
+/* Factor of change of threshold of level of detail between frames */
+#define RENDER_LOD_STEP		1.25
+
+/* Kinds of items received from server */
+#define LIVE_ITEM_VERTEX	0
+#define LIVE_ITEM_NORMAL	1
+#define LIVE_ITEM_FACE		2
+#define LIVE_ITEM_KINDS		3
+
+/**
+ * Item of layer received from server and passed to display thread
+ */
+typedef struct LiveItem {
+	uint32_t item_id;
+	uint8_t kind;
+	uint8_t data_type;
+	uint8_t count;
+	/* Raw value of item (up to four 64-bit values) */
+	uint64_t value[4];
+} LiveItem;
+
+/**
+ * Range of items [first, last) changed since last frame
+ */
+typedef struct DirtyRange {
+	uint64_t first;
+	uint64_t last;
+} DirtyRange;
+
+/**
+ * Items dropped, because queue of display thread was full. Display thread
+ * restores them from the uploaded mesh in context. Bitmaps are set by
+ * thread receiving data from server and cleared by display thread.
+ */
+typedef struct LiveResync {
+	/* Flag of dropped items, which were not restored yet */
+	atomic_int pending;
+	/* Bitmaps of dropped items indexed by kind of item */
+	atomic_uint_fast64_t *dropped[LIVE_ITEM_KINDS];
+	uint64_t nitems[LIVE_ITEM_KINDS];
+} LiveResync;
+
+/**
+ * Range of triangles waiting for draw call. Adjacent ranges of nodes
+ * are merged to one draw call.
+ */
+typedef struct DrawBatch {
+	GLuint buffer;
+	uint64_t first;
+	uint64_t count;
+} DrawBatch;
+
+/**
+ * State of one traversal of octree
+ */
+typedef struct Traversal {
+	/* Normalized planes of view frustum: left, right, bottom, top, near, far */
+	double planes[6][4];
+	double near_plane;
+	/* Number of pixels per unit of length in the distance 1 */
+	double pixels;
+	struct DrawBatch full;
+	struct DrawBatch proxy;
+	/* The smallest node refined or drawn fully and the biggest node
+	 * replaced with proxy due to threshold of level of detail */
+	double min_refined;
+	double max_simplified;
+} Traversal;
+
+/**
+ * \brief Initialize OpenGL context
+ */
+static void render_gl_init(void)
+{
+	static float light_ambient[4] = {0.7, 0.7, 0.7, 1.0};
+	static float light_diffuse[4] = {0.9, 0.9, 0.9, 1.0};
+	/* Directional light shining from camera */
+	static float light_position[4] = {0.0, 0.0, 1.0, 0.0};
+	static float material_ambient[4] = {0.2, 0.2, 0.2, 1.0};
+	static float material_diffuse[4] = {0.4, 0.4, 0.4, 1.0};
+	static float material_specular[4] = {0.5, 0.5, 0.5, 1.0};
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClearDepth(1.0f);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glPointSize(2.0);
+	glLineWidth(1.0);
+	glEnable(GL_POINT_SMOOTH);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+	/* Orientation of faces in PLY files is not reliable */
+	glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material_ambient);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material_diffuse);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material_specular);
+	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, 20.0);	/* TODO: add to ctx */
+}
+
+/**
+ * \brief This function sets up camera to see whole bounding box of mesh
+ */
+void render_camera_fit(struct Renderer *renderer)
+{
+	struct Camera *camera = &renderer->camera;
+	struct CTX *ctx = renderer->ctx;
+	struct BBox bbox;
+	double size[3];
+	int i;
+
+	camera->yaw = -45.0;
+	camera->pitch = -60.0;
+
+	if(ctx->nvertices == 0 || mesh_bbox(ctx, &bbox) != 1) {
+		camera->center[0] = camera->center[1] = camera->center[2] = 0.0;
+		camera->radius = 1.0;
+	} else {
+		for(i = 0; i < 3; i++) {
+			camera->center[i] = 0.5*(bbox.min[i] + bbox.max[i]);
+			size[i] = bbox.max[i] - bbox.min[i];
+		}
+		camera->radius = 0.5*sqrt(size[0]*size[0] + size[1]*size[1] + size[2]*size[2]);
+		if(camera->radius <= 0.0) {
+			camera->radius = 1.0;
+		}
+	}
+
+	/* Bounding sphere fits to the vertical field of view */
+	camera->distance = 1.1 * camera->radius / sin(0.5 * RENDER_FOV * M_PI / 180.0);
+}
+
+/**
+ * \brief This function uploads vertices and normals (when they are
+ * available) to vertex buffer object. Vertices are interleaved with
+ * normals in one buffer.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int upload_vertices(struct Renderer *renderer)
+{
+	struct CTX *ctx = renderer->ctx;
+	struct PropLayer *normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+	float *data;
+	uint64_t i;
+	int k;
+
+	if(normals != NULL && (normals->count != 3 ||
+			(normals->data_type != VRS_VALUE_TYPE_REAL32 &&
+			 normals->data_type != VRS_VALUE_TYPE_REAL64))) {
+		normals = NULL;
+	}
+	renderer->vertex_size = (normals != NULL) ? 6 : 3;
+
+	data = (float*)malloc(ctx->nvertices * renderer->vertex_size * sizeof(float));
+	if(data == NULL && ctx->nvertices > 0) {
+		return 0;
+	}
+
+	for(i = 0; i < ctx->nvertices; i++) {
+		float *vertex = &data[renderer->vertex_size * i];
+		vertex[0] = (float)ctx->vx[i];
+		vertex[1] = (float)ctx->vy[i];
+		vertex[2] = (float)ctx->vz[i];
+		if(normals != NULL) {
+			for(k = 0; k < 3; k++) {
+				vertex[3 + k] = (normals->data_type == VRS_VALUE_TYPE_REAL32) ?
+						((float*)normals->data)[3*i + k] :
+						(float)((double*)normals->data)[3*i + k];
+			}
+		}
+	}
+
+	glGenBuffers(1, &renderer->vertex_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER,
+			ctx->nvertices * renderer->vertex_size * sizeof(float),
+			data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	renderer->vertex_count = ctx->nvertices;
+
+	free(data);
+
+	return 1;
+}
+
+/**
+ * \brief This function builds octree of faces. It is started in separate
+ * thread, because it can take several seconds for huge meshes.
+ */
+static void *octree_thread(void *arg)
+{
+	struct Renderer *renderer = (struct Renderer*)arg;
+	uint64_t start;
+
+	trace_thread_name("octree");
+	start = trace_begin();
+
+	renderer->octree = octree_build(renderer->ctx);
+	trace_end("octree_build", "render", start, -1);
+	if(renderer->octree == NULL) {
+		printf("ERROR: Unable to build octree of mesh\n");
+	}
+
+	atomic_store_explicit(&renderer->octree_ready, 1, memory_order_release);
+
+	return NULL;
+}
+
+/**
+ * \brief This function uploads triangles and proxies sorted by nodes of
+ * octree to index buffers, when octree was built.
+ *
+ * @return 1, when buffers were uploaded, 0 otherwise
+ */
+static int upload_octree(struct Renderer *renderer)
+{
+	struct Octree *octree = renderer->octree;
+
+	if(renderer->octree_thread_running == 0 ||
+			atomic_load_explicit(&renderer->octree_ready, memory_order_acquire) == 0) {
+		return 0;
+	}
+
+	pthread_join(renderer->octree_thread, NULL);
+	renderer->octree_thread_running = 0;
+
+	if(octree == NULL) {
+		return 0;
+	}
+
+	glGenBuffers(1, &renderer->index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * octree->ntriangles * sizeof(GLuint),
+			octree->triangles, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &renderer->proxy_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->proxy_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * octree->nproxies * sizeof(GLuint),
+			octree->proxies, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	renderer->index_count = 3 * octree->ntriangles;
+
+	/* Only nodes are needed for traversal */
+	free(octree->triangles);
+	octree->triangles = NULL;
+	free(octree->proxies);
+	octree->proxies = NULL;
+
+	return 1;
+}
+
+/**
+ * \brief This function creates empty buffer objects for mesh received from
+ * server. Every face has six indices (two triangles), so position of face
+ * in index buffer does not depend on faces received before. Zero indices
+ * are degenerated triangles, which are not drawn.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int live_buffers_init(struct Renderer *renderer)
+{
+	struct CTX *ctx = renderer->ctx;
+	struct PropLayer *normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+
+	renderer->vertex_size = (normals != NULL && normals->count == 3) ? 6 : 3;
+	renderer->vertex_capacity = ctx->nvertices;
+	renderer->index_count = 6 * ctx->nquads;
+
+	renderer->vertex_data = (float*)calloc(renderer->vertex_capacity * renderer->vertex_size, sizeof(float));
+	renderer->index_data = (uint32_t*)calloc(renderer->index_count, sizeof(uint32_t));
+	if((renderer->vertex_data == NULL && renderer->vertex_capacity > 0) ||
+			(renderer->index_data == NULL && renderer->index_count > 0)) {
+		return 0;
+	}
+
+	glGenBuffers(1, &renderer->vertex_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER,
+			renderer->vertex_capacity * renderer->vertex_size * sizeof(float),
+			renderer->vertex_data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &renderer->index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, renderer->index_count * sizeof(GLuint),
+			renderer->index_data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	/* Faces are drawn over all vertices, point cloud only over received ones */
+	renderer->vertex_count = (ctx->nquads > 0) ? renderer->vertex_capacity : 0;
+
+	return 1;
+}
+
+static void dirty_range_add(struct DirtyRange *range, uint64_t item)
+{
+	if(item < range->first) range->first = item;
+	if(item + 1 > range->last) range->last = item + 1;
+}
+
+/**
+ * \brief This function writes one received item to the copy of buffers
+ *
+ * @return 1, when item was stored, 0, when it was not valid
+ */
+static int live_item_store(struct Renderer *renderer,
+		const struct LiveItem *item,
+		struct DirtyRange *vertices,
+		struct DirtyRange *indices)
+{
+	struct CTX *ctx = renderer->ctx;
+	double value[4];
+	uint64_t i;
+	int k;
+
+	switch(item->kind) {
+	case LIVE_ITEM_VERTEX:
+	case LIVE_ITEM_NORMAL:
+		if(item->item_id >= renderer->vertex_capacity) return 0;
+		if(item->kind == LIVE_ITEM_NORMAL && renderer->vertex_size != 6) return 0;
+
+		if(item->data_type == VRS_VALUE_TYPE_REAL64 && item->count >= 3) {
+			for(k = 0; k < 3; k++) value[k] = ((const double*)item->value)[k];
+		} else if(item->data_type == VRS_VALUE_TYPE_REAL32 && item->count >= 3) {
+			for(k = 0; k < 3; k++) value[k] = ((const float*)item->value)[k];
+		} else if(item->kind == LIVE_ITEM_VERTEX && ctx->quantization != NULL &&
+				item->data_type == ctx->quantization->data_type) {
+			quantization_decode(ctx->quantization, item->value, value);
+		} else {
+			return 0;
+		}
+
+		i = renderer->vertex_size * item->item_id + ((item->kind == LIVE_ITEM_NORMAL) ? 3 : 0);
+		for(k = 0; k < 3; k++) {
+			renderer->vertex_data[i + k] = (float)value[k];
+		}
+		dirty_range_add(vertices, item->item_id);
+		break;
+	case LIVE_ITEM_FACE:
+		{
+			const uint64_t *quad = item->value;
+			uint32_t *index;
+
+			if(item->item_id >= ctx->nquads ||
+					item->data_type != VRS_VALUE_TYPE_UINT64 || item->count != 4) {
+				return 0;
+			}
+			for(k = 0; k < 4; k++) {
+				if(quad[k] >= renderer->vertex_capacity) return 0;
+			}
+
+			index = &renderer->index_data[6 * item->item_id];
+			index[0] = (uint32_t)quad[0];
+			index[1] = (uint32_t)quad[1];
+			index[2] = (uint32_t)quad[2];
+			/* Received face is triangle, when its last index is zero, and
+			 * its second triangle is degenerated */
+			index[3] = (uint32_t)quad[0];
+			index[4] = (uint32_t)((quad[3] != 0) ? quad[2] : quad[0]);
+			index[5] = (uint32_t)((quad[3] != 0) ? quad[3] : quad[0]);
+			dirty_range_add(indices, item->item_id);
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function fills item with value uploaded to server, which is
+ * used instead of item dropped from queue
+ *
+ * @return 1 on success, 0, when item does not exist
+ */
+static int live_item_source(struct CTX *ctx, uint8_t kind, uint64_t item_id,
+		struct LiveItem *item)
+{
+	struct Quantization *quant = ctx->quantization;
+	struct PropLayer *normals;
+
+	item->item_id = (uint32_t)item_id;
+	item->kind = kind;
+
+	switch(kind) {
+	case LIVE_ITEM_VERTEX:
+		if(item_id >= ctx->nvertices) return 0;
+		if(quant != NULL) {
+			if(quant->item_size > sizeof(item->value)) return 0;
+			item->data_type = quant->data_type;
+			item->count = quant->count;
+			memcpy(item->value, (const char*)quant->data + item_id*quant->item_size,
+					quant->item_size);
+		} else {
+			double vertex[3] = {ctx->vx[item_id], ctx->vy[item_id], ctx->vz[item_id]};
+			item->data_type = VRS_VALUE_TYPE_REAL64;
+			item->count = 3;
+			memcpy(item->value, vertex, sizeof(vertex));
+		}
+		break;
+	case LIVE_ITEM_NORMAL:
+		normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+		if(normals == NULL || item_id >= normals->nitems ||
+				normals->item_size > sizeof(item->value)) {
+			return 0;
+		}
+		item->data_type = normals->data_type;
+		item->count = normals->count;
+		memcpy(item->value, (const char*)normals->data + item_id*normals->item_size,
+				normals->item_size);
+		break;
+	case LIVE_ITEM_FACE:
+		if(item_id >= ctx->nquads) return 0;
+		item->data_type = VRS_VALUE_TYPE_UINT64;
+		item->count = 4;
+		memcpy(item->value, &ctx->quads[4*item_id], 4*sizeof(uint64_t));
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function restores items dropped from queue from the mesh
+ * uploaded to server. Server sends back the same values, so only items,
+ * which were already received, are restored.
+ *
+ * @return Number of restored items
+ */
+static uint64_t live_buffers_resync(struct Renderer *renderer,
+		struct DirtyRange *vertices,
+		struct DirtyRange *indices)
+{
+	struct CTX *ctx = renderer->ctx;
+	struct LiveResync *resync = ctx->live_resync;
+	struct LiveItem item;
+	uint64_t count = 0, word, bits, bit;
+	uint8_t kind;
+
+	if(atomic_exchange_explicit(&resync->pending, 0, memory_order_acquire) == 0) {
+		return 0;
+	}
+
+	for(kind = 0; kind < LIVE_ITEM_KINDS; kind++) {
+		for(word = 0; word < (resync->nitems[kind] + 63) / 64; word++) {
+			bits = atomic_exchange_explicit(&resync->dropped[kind][word], 0,
+					memory_order_acquire);
+			for(bit = 0; bits != 0; bit++, bits >>= 1) {
+				if((bits & 1) == 1 &&
+						live_item_source(ctx, kind, 64*word + bit, &item) == 1 &&
+						live_item_store(renderer, &item, vertices, indices) == 1) {
+					count++;
+				}
+			}
+		}
+	}
+
+	renderer->restored += count;
+
+	return count;
+}
+
+/**
+ * \brief This function moves all items received from server since last call
+ * to buffer objects. Items dropped from queue are restored from uploaded
+ * mesh. Only changed range of each buffer is uploaded.
+ *
+ * @return Number of processed items
+ */
+static uint64_t live_buffers_update(struct Renderer *renderer)
+{
+	struct CTX *ctx = renderer->ctx;
+	struct DirtyRange vertices = {UINT64_MAX, 0};
+	struct DirtyRange indices = {UINT64_MAX, 0};
+	struct LiveItem item;
+	uint64_t count = 0;
+
+	while(spsc_queue_pop(ctx->live_queue, &item) == 1) {
+		live_item_store(renderer, &item, &vertices, &indices);
+		count++;
+	}
+	renderer->received += count;
+
+	count += live_buffers_resync(renderer, &vertices, &indices);
+
+	if(vertices.first < vertices.last) {
+		GLsizeiptr size = renderer->vertex_size * sizeof(float);
+		glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER,
+				vertices.first * size,
+				(vertices.last - vertices.first) * size,
+				&renderer->vertex_data[renderer->vertex_size * vertices.first]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if(ctx->nquads == 0 && vertices.last > renderer->vertex_count) {
+			renderer->vertex_count = vertices.last;
+		}
+	}
+
+	if(indices.first < indices.last) {
+		GLsizeiptr size = 6 * sizeof(GLuint);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+				indices.first * size,
+				(indices.last - indices.first) * size,
+				&renderer->index_data[6 * indices.first]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	return count;
+}
+
+/**
+ * \brief This function passes item of layer received from server to
+ * the display thread. It is called from thread receiving data from
+ * server and it never blocks. Items of other layers than vertices,
+ * normals and faces of uploaded mesh are ignored. When queue is full,
+ * item is marked in bitmap of dropped items and display thread restores
+ * it from uploaded mesh.
+ *
+ * @return 1 on success, 0, when item was ignored or dropped
+ */
+int render_live_push(struct CTX *ctx,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value)
+{
+	struct LiveItem item;
+	size_t size = value_type_size(data_type) * count;
+
+	if(ctx->live_queue == NULL ||
+			node_id != ctx->my_mesh_node_id ||
+			size == 0 || size > sizeof(item.value)) {
+		return 0;
+	}
+
+	if(layer_id == ctx->my_vertex_layer_id) {
+		item.kind = LIVE_ITEM_VERTEX;
+	} else if(layer_id == ctx->my_face_layer_id) {
+		item.kind = LIVE_ITEM_FACE;
+	} else {
+		struct PropLayer *normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+		if(normals == NULL || normals->layer_id != layer_id) {
+			return 0;
+		}
+		item.kind = LIVE_ITEM_NORMAL;
+	}
+
+	item.item_id = item_id;
+	item.data_type = data_type;
+	item.count = count;
+	memcpy(item.value, value, size);
+
+	if(spsc_queue_push(ctx->live_queue, &item) != 1) {
+		struct LiveResync *resync = ctx->live_resync;
+		if(item_id < resync->nitems[item.kind]) {
+			atomic_fetch_or_explicit(&resync->dropped[item.kind][item_id / 64],
+					(uint_fast64_t)1 << (item_id % 64), memory_order_release);
+			atomic_store_explicit(&resync->pending, 1, memory_order_release);
+		}
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function creates queue of items passed to display thread
+ * in live mode and bitmaps of items dropped from queue. It has to be called
+ * after mesh is prepared for upload and before display thread is started.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int render_live_init(struct CTX *ctx)
+{
+	struct LiveResync *resync;
+	struct PropLayer *normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+	uint8_t kind;
+
+	ctx->live_queue = spsc_queue_create(RENDER_LIVE_QUEUE_SIZE, sizeof(struct LiveItem));
+	resync = (struct LiveResync*)calloc(1, sizeof(struct LiveResync));
+	ctx->live_resync = resync;
+	if(ctx->live_queue == NULL || resync == NULL) {
+		return 0;
+	}
+
+	atomic_init(&resync->pending, 0);
+	resync->nitems[LIVE_ITEM_VERTEX] = ctx->nvertices;
+	resync->nitems[LIVE_ITEM_NORMAL] = (normals != NULL) ? normals->nitems : 0;
+	resync->nitems[LIVE_ITEM_FACE] = ctx->nquads;
+
+	for(kind = 0; kind < LIVE_ITEM_KINDS; kind++) {
+		uint64_t i, nwords = (resync->nitems[kind] + 63) / 64;
+		resync->dropped[kind] = (atomic_uint_fast64_t*)malloc(
+				(nwords + 1) * sizeof(atomic_uint_fast64_t));
+		if(resync->dropped[kind] == NULL) {
+			return 0;
+		}
+		for(i = 0; i < nwords; i++) {
+			atomic_init(&resync->dropped[kind][i], 0);
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function frees queue of items passed to display thread and
+ * bitmaps of dropped items. It has to be called after session is finished.
+ */
+void render_live_free(struct CTX *ctx)
+{
+	struct LiveResync *resync = ctx->live_resync;
+	uint8_t kind;
+
+	spsc_queue_free(ctx->live_queue);
+	ctx->live_queue = NULL;
+
+	if(resync == NULL) return;
+
+	for(kind = 0; kind < LIVE_ITEM_KINDS; kind++) {
+		free(resync->dropped[kind]);
+	}
+	free(resync);
+	ctx->live_resync = NULL;
+}
+
+/**
+ * \brief This function initializes OpenGL context and uploads vertices to
+ * buffer object. Octree of faces is built in background thread and faces
+ * are drawn, when it is finished. In live mode, buffers are created empty
+ * and they are filled with data received from server.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int render_init(struct Renderer *renderer, struct CTX *ctx)
+{
+	memset(renderer, 0, sizeof(struct Renderer));
+	renderer->ctx = ctx;
+	renderer->triangle_budget = (ctx->display_budget > 0) ?
+			ctx->display_budget : RENDER_TRIANGLE_BUDGET;
+	renderer->lod_pixels = RENDER_LOD_PIXELS;
+	atomic_init(&renderer->octree_ready, 0);
+
+	render_gl_init();
+	render_camera_fit(renderer);
+
+	if(ctx->nvertices > UINT32_MAX) {
+		printf("ERROR: Too many vertices to display: %lu\n",
+				(unsigned long)ctx->nvertices);
+		return 0;
+	}
+
+	if(ctx->live_queue != NULL) {
+		if(live_buffers_init(renderer) != 1) {
+			printf("ERROR: Unable to create buffer objects\n");
+			return 0;
+		}
+		return 1;
+	}
+
+	if(upload_vertices(renderer) != 1) {
+		printf("ERROR: Unable to upload mesh to buffer objects\n");
+		return 0;
+	}
+
+	if(ctx->nquads > 0) {
+		if(pthread_create(&renderer->octree_thread, NULL, octree_thread, renderer) != 0) {
+			return 0;
+		}
+		renderer->octree_thread_running = 1;
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function moves new data to buffer objects: octree, when it
+ * was built or items received from server in live mode.
+ *
+ * @return Nonzero value, when scene was changed
+ */
+uint64_t render_update(struct Renderer *renderer)
+{
+	if(renderer->ctx->live_queue != NULL) {
+		return live_buffers_update(renderer);
+	}
+
+	return (uint64_t)upload_octree(renderer);
+}
+
+/**
+ * \brief This function extracts normalized planes of view frustum from
+ * current projection and modelview matrices
+ */
+static void frustum_planes(struct Traversal *traversal)
+{
+	double p[16], m[16], clip[4][4], len;
+	int i, j, k;
+
+	glGetDoublev(GL_PROJECTION_MATRIX, p);
+	glGetDoublev(GL_MODELVIEW_MATRIX, m);
+
+	/* Matrices are stored in column-major order: element (row i, column j) is m[4*j + i] */
+	for(i = 0; i < 4; i++) {
+		for(j = 0; j < 4; j++) {
+			clip[i][j] = 0.0;
+			for(k = 0; k < 4; k++) {
+				clip[i][j] += p[4*k + i] * m[4*j + k];
+			}
+		}
+	}
+
+	for(k = 0; k < 3; k++) {
+		for(j = 0; j < 4; j++) {
+			traversal->planes[2*k][j] = clip[3][j] + clip[k][j];
+			traversal->planes[2*k + 1][j] = clip[3][j] - clip[k][j];
+		}
+	}
+
+	for(i = 0; i < 6; i++) {
+		len = sqrt(traversal->planes[i][0]*traversal->planes[i][0] +
+				traversal->planes[i][1]*traversal->planes[i][1] +
+				traversal->planes[i][2]*traversal->planes[i][2]);
+		for(j = 0; j < 4; j++) {
+			traversal->planes[i][j] /= len;
+		}
+	}
+}
+
+/**
+ * \brief This function returns 1, when bounding box of node intersects
+ * view frustum
+ */
+static int node_visible(const struct Traversal *traversal, const struct OctreeNode *node)
+{
+	int i;
+
+	for(i = 0; i < 6; i++) {
+		const double *plane = traversal->planes[i];
+		/* The corner of box lying furthest in direction of normal of plane */
+		double x = (plane[0] > 0.0) ? node->max[0] : node->min[0];
+		double y = (plane[1] > 0.0) ? node->max[1] : node->min[1];
+		double z = (plane[2] > 0.0) ? node->max[2] : node->min[2];
+
+		if(plane[0]*x + plane[1]*y + plane[2]*z + plane[3] < 0.0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * \brief This function returns distance of center of node from camera
+ * measured along view direction
+ */
+static double node_depth(const struct Traversal *traversal, const struct OctreeNode *node)
+{
+	const double *plane = traversal->planes[4];
+	double depth = traversal->near_plane + plane[3];
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		depth += plane[k] * 0.5 * (node->min[k] + node->max[k]);
+	}
+
+	return (depth > traversal->near_plane) ? depth : traversal->near_plane;
+}
+
+static void batch_flush(struct Renderer *renderer, struct DrawBatch *batch)
+{
+	uint64_t first, count;
+
+	if(batch->count == 0) {
+		return;
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->buffer);
+	for(first = 3 * batch->first; first < 3 * (batch->first + batch->count); first += count) {
+		count = 3 * (batch->first + batch->count) - first;
+		if(count > RENDER_MAX_DRAW_INDICES) {
+			count = RENDER_MAX_DRAW_INDICES;
+		}
+		glDrawElements(GL_TRIANGLES, (GLsizei)count, GL_UNSIGNED_INT,
+				(void*)(first * sizeof(GLuint)));
+		renderer->stats.draw_calls++;
+	}
+
+	batch->count = 0;
+}
+
+static void batch_add(struct Renderer *renderer, struct DrawBatch *batch,
+		uint64_t first, uint64_t count)
+{
+	if(batch->count > 0 && batch->first + batch->count == first) {
+		batch->count += count;
+	} else {
+		batch_flush(renderer, batch);
+		batch->first = first;
+		batch->count = count;
+	}
+
+	renderer->stats.triangles += count;
+}
+
+/**
+ * \brief This function draws visible node of octree. Proxy of node is
+ * drawn, when node is projected to less pixels than current threshold or
+ * when budget of triangles was exhausted. Children are visited from front
+ * to back, so the closest nodes get the most detail.
+ */
+static void render_node(struct Renderer *renderer, struct Traversal *traversal, int32_t node_id)
+{
+	const struct OctreeNode *node = &renderer->octree->nodes[node_id];
+	double size, diagonal = 0.0, depth[8];
+	int32_t order[8];
+	int i, j, k, nchildren = 0;
+
+	if(node->count == 0 || node_visible(traversal, node) == 0) {
+		return;
+	}
+
+	for(k = 0; k < 3; k++) {
+		diagonal += (node->max[k] - node->min[k]) * (node->max[k] - node->min[k]);
+	}
+	size = sqrt(diagonal) * traversal->pixels / node_depth(traversal, node);
+
+	/* Sort children by depth */
+	for(i = 0; i < 8; i++) {
+		int32_t child_id = node->children[i];
+		double child_depth;
+
+		if(child_id == -1) continue;
+		child_depth = node_depth(traversal, &renderer->octree->nodes[child_id]);
+		for(j = nchildren; j > 0 && depth[j - 1] > child_depth; j--) {
+			depth[j] = depth[j - 1];
+			order[j] = order[j - 1];
+		}
+		depth[j] = child_depth;
+		order[j] = child_id;
+		nchildren++;
+	}
+
+	if(node->proxy_count > 0) {
+		if(size < renderer->lod_pixels) {
+			if(size > traversal->max_simplified) traversal->max_simplified = size;
+		} else {
+			if(size < traversal->min_refined) traversal->min_refined = size;
+		}
+	}
+
+	if(nchildren == 0 || size < renderer->lod_pixels ||
+			renderer->stats.triangles >= renderer->triangle_budget) {
+		renderer->stats.nodes++;
+		if(node->proxy_count > 0 && (size < renderer->lod_pixels ||
+				renderer->stats.triangles + node->count > renderer->triangle_budget)) {
+			batch_add(renderer, &traversal->proxy, node->proxy_first, node->proxy_count);
+		} else {
+			batch_add(renderer, &traversal->full, node->first, node->count);
+		}
+		return;
+	}
+
+	for(i = 0; i < nchildren; i++) {
+		render_node(renderer, traversal, order[i]);
+	}
+}
+
+/**
+ * \brief This function adjusts threshold of level of detail to keep number
+ * of drawn triangles between half of budget and budget. Threshold is
+ * changed only, when the change affects some visible node.
+ *
+ * @return 1, when threshold was changed and scene should be drawn again
+ */
+static int render_lod_feedback(struct Renderer *renderer, const struct Traversal *traversal)
+{
+	double lod = renderer->lod_pixels;
+
+	if(renderer->stats.triangles > renderer->triangle_budget &&
+			lod * RENDER_LOD_STEP < RENDER_LOD_MAX_PIXELS &&
+			traversal->min_refined < lod * RENDER_LOD_STEP) {
+		renderer->lod_pixels = lod * RENDER_LOD_STEP;
+		return 1;
+	}
+
+	if(renderer->stats.triangles < renderer->triangle_budget / 2 &&
+			lod / RENDER_LOD_STEP > RENDER_LOD_MIN_PIXELS &&
+			traversal->max_simplified >= lod / RENDER_LOD_STEP) {
+		renderer->lod_pixels = lod / RENDER_LOD_STEP;
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief This function draws one frame
+ *
+ * @return 1, when level of detail was changed and next frame should
+ * be drawn, 0 otherwise
+ */
+int render_frame(struct Renderer *renderer, int width, int height)
+{
+	struct Camera *camera = &renderer->camera;
+	struct Traversal traversal;
+	double near_plane, far_plane, top, right;
+	GLsizei stride = renderer->vertex_size * sizeof(float);
+	int changed = 0;
+
+	renderer->stats.triangles = 0;
+	renderer->stats.nodes = 0;
+	renderer->stats.draw_calls = 0;
+
+	if(height <= 0) height = 1;
+
+	glViewport(0, 0, width, height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	/* Clipping planes enclose bounding sphere of mesh */
+	far_plane = camera->distance + camera->radius;
+	near_plane = camera->distance - camera->radius;
+	if(near_plane < 0.001 * camera->radius) {
+		near_plane = 0.001 * camera->radius;
+	}
+	top = near_plane * tan(0.5 * RENDER_FOV * M_PI / 180.0);
+	right = top * (double)width / (double)height;
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glFrustum(-right, right, -top, top, near_plane, far_plane);
+
+	/* Orbit around center of bounding box, axis Z is up */
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glTranslated(0.0, 0.0, -camera->distance);
+	glRotated(camera->pitch, 1.0, 0.0, 0.0);
+	glRotated(camera->yaw, 0.0, 0.0, 1.0);
+	glTranslated(-camera->center[0], -camera->center[1], -camera->center[2]);
+
+	if(renderer->vertex_count == 0) {
+		return 0;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->vertex_buffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, (void*)0);
+	if(renderer->vertex_size == 6) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, stride, (void*)(3*sizeof(float)));
+	} else {
+		glNormal3f(0.0, 0.0, 1.0);
+	}
+
+	if(renderer->octree != NULL && renderer->octree_thread_running == 0) {
+		/* Octree: only visible nodes with level of detail */
+		frustum_planes(&traversal);
+		traversal.near_plane = near_plane;
+		traversal.pixels = height / (2.0 * tan(0.5 * RENDER_FOV * M_PI / 180.0));
+		traversal.full.buffer = renderer->index_buffer;
+		traversal.full.count = 0;
+		traversal.proxy.buffer = renderer->proxy_buffer;
+		traversal.proxy.count = 0;
+		traversal.min_refined = RENDER_LOD_MAX_PIXELS;
+		traversal.max_simplified = 0.0;
+
+		render_node(renderer, &traversal, 0);
+		batch_flush(renderer, &traversal.full);
+		batch_flush(renderer, &traversal.proxy);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		changed = render_lod_feedback(renderer, &traversal);
+	} else if(renderer->ctx->live_queue != NULL && renderer->index_count > 0) {
+		/* Live mode: all faces received from server */
+		struct DrawBatch batch;
+		batch.buffer = renderer->index_buffer;
+		batch.first = 0;
+		batch.count = renderer->index_count / 3;
+		batch_flush(renderer, &batch);
+		renderer->stats.triangles = renderer->index_count / 3;
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	} else if(renderer->ctx->nquads == 0) {
+		/* Point cloud */
+		glDrawArrays(GL_POINTS, 0, (GLsizei)renderer->vertex_count);
+		renderer->stats.draw_calls++;
+	}
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return changed;
+}
+
+/**
+ * \brief This function frees buffer objects and octree
+ */
+void render_free(struct Renderer *renderer)
+{
+	if(renderer->octree_thread_running == 1) {
+		pthread_join(renderer->octree_thread, NULL);
+		renderer->octree_thread_running = 0;
+	}
+
+	if(renderer->vertex_buffer != 0) glDeleteBuffers(1, &renderer->vertex_buffer);
+	if(renderer->index_buffer != 0) glDeleteBuffers(1, &renderer->index_buffer);
+	if(renderer->proxy_buffer != 0) glDeleteBuffers(1, &renderer->proxy_buffer);
+	if(renderer->vertex_data != NULL) free(renderer->vertex_data);
+	if(renderer->index_data != NULL) free(renderer->index_data);
+	octree_free(renderer->octree);
+
+	memset(renderer, 0, sizeof(struct Renderer));
+}
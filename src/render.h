@@ -0,0 +1,131 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+/* Vertical field of view of camera in degrees */
+#define RENDER_FOV			45.0
+
+/* Default maximal number of triangles drawn in one frame */
+#define RENDER_TRIANGLE_BUDGET		1000000
+
+/* Initial projected size (pixels) of node, when its proxy is drawn */
+#define RENDER_LOD_PIXELS		64.0
+
+/* Maximal number of items waiting for display thread in live mode */
+#define RENDER_LIVE_QUEUE_SIZE		(1 << 18)
+
+struct CTX;
+struct Octree;
+
+/**
+ * Orbit camera looking at center of bounding box of mesh
+ */
+typedef struct Camera {
+	double center[3];
+	double radius;
+	double distance;
+	double yaw;
+	double pitch;
+} Camera;
+
+/**
+ * Statistics of last drawn frame
+ */
+typedef struct RenderStats {
+	uint64_t triangles;
+	uint32_t nodes;
+	uint32_t draw_calls;
+} RenderStats;
+
+/**
+ * State of renderer. Buffer objects contain mesh uploaded to graphics
+ * card. All functions except render_live_push() have to be called from
+ * the thread owning OpenGL context.
+ */
+typedef struct Renderer {
+	struct CTX *ctx;
+
+	struct Camera camera;
+
+	/* Buffer objects (GLuint) */
+	unsigned int vertex_buffer;
+	unsigned int index_buffer;
+	unsigned int proxy_buffer;
+
+	/* Number of floats of one vertex (position and optional normal) */
+	int vertex_size;
+	uint64_t vertex_count;
+	uint64_t index_count;
+
+	/* Copy of buffers updated from server in live mode */
+	float *vertex_data;
+	uint32_t *index_data;
+	uint64_t vertex_capacity;
+	uint64_t received;
+	/* Number of items dropped from queue and restored from uploaded mesh */
+	uint64_t restored;
+
+	/* Octree built in background thread */
+	struct Octree *octree;
+	pthread_t octree_thread;
+	int octree_thread_running;
+	atomic_int octree_ready;
+
+	/* Level of detail adjusted to keep number of triangles in budget */
+	uint64_t triangle_budget;
+	double lod_pixels;
+
+	struct RenderStats stats;
+} Renderer;
+
+int render_init(struct Renderer *renderer, struct CTX *ctx);
+
+void render_camera_fit(struct Renderer *renderer);
+
+uint64_t render_update(struct Renderer *renderer);
+
+int render_frame(struct Renderer *renderer, int width, int height);
+
+void render_free(struct Renderer *renderer);
+
+int render_live_init(struct CTX *ctx);
+
+void render_live_free(struct CTX *ctx);
+
+int render_live_push(struct CTX *ctx,
+		const uint32_t node_id,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value);
+
+#endif /* RENDER_H_ */
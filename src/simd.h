@@ -0,0 +1,138 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include "mesh.h"
+
+/*
+ * Minimal set of vector operations on mesh_real used by kernels working
+ * on structure-of-arrays buffers of mesh. The widest instruction set
+ * enabled by compiler flags is used (e.g. -march=native or -mavx2).
+ * SIMD_WIDTH is number of mesh_real values in one vector.
+ */
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef WITH_SINGLE_PRECISION
+
+#if defined(__AVX512F__)
+typedef __m512d simd_real;
+#define SIMD_WIDTH 8
+#define simd_set1 _mm512_set1_pd
+#define simd_load _mm512_loadu_pd
+#define simd_store _mm512_storeu_pd
+#define simd_add _mm512_add_pd
+#define simd_sub _mm512_sub_pd
+#define simd_mul _mm512_mul_pd
+#define simd_div _mm512_div_pd
+#define simd_min _mm512_min_pd
+#define simd_max _mm512_max_pd
+#define simd_sqrt _mm512_sqrt_pd
+#elif defined(__AVX__)
+typedef __m256d simd_real;
+#define SIMD_WIDTH 4
+#define simd_set1 _mm256_set1_pd
+#define simd_load _mm256_loadu_pd
+#define simd_store _mm256_storeu_pd
+#define simd_add _mm256_add_pd
+#define simd_sub _mm256_sub_pd
+#define simd_mul _mm256_mul_pd
+#define simd_div _mm256_div_pd
+#define simd_min _mm256_min_pd
+#define simd_max _mm256_max_pd
+#define simd_sqrt _mm256_sqrt_pd
+#elif defined(__SSE2__)
+typedef __m128d simd_real;
+#define SIMD_WIDTH 2
+#define simd_set1 _mm_set1_pd
+#define simd_load _mm_loadu_pd
+#define simd_store _mm_storeu_pd
+#define simd_add _mm_add_pd
+#define simd_sub _mm_sub_pd
+#define simd_mul _mm_mul_pd
+#define simd_div _mm_div_pd
+#define simd_min _mm_min_pd
+#define simd_max _mm_max_pd
+#define simd_sqrt _mm_sqrt_pd
+#endif
+
+#else /* WITH_SINGLE_PRECISION */
+
+#if defined(__AVX512F__)
+typedef __m512 simd_real;
+#define SIMD_WIDTH 16
+#define simd_set1 _mm512_set1_ps
+#define simd_load _mm512_loadu_ps
+#define simd_store _mm512_storeu_ps
+#define simd_add _mm512_add_ps
+#define simd_sub _mm512_sub_ps
+#define simd_mul _mm512_mul_ps
+#define simd_div _mm512_div_ps
+#define simd_min _mm512_min_ps
+#define simd_max _mm512_max_ps
+#define simd_sqrt _mm512_sqrt_ps
+#elif defined(__AVX__)
+typedef __m256 simd_real;
+#define SIMD_WIDTH 8
+#define simd_set1 _mm256_set1_ps
+#define simd_load _mm256_loadu_ps
+#define simd_store _mm256_storeu_ps
+#define simd_add _mm256_add_ps
+#define simd_sub _mm256_sub_ps
+#define simd_mul _mm256_mul_ps
+#define simd_div _mm256_div_ps
+#define simd_min _mm256_min_ps
+#define simd_max _mm256_max_ps
+#define simd_sqrt _mm256_sqrt_ps
+#elif defined(__SSE2__)
+typedef __m128 simd_real;
+#define SIMD_WIDTH 4
+#define simd_set1 _mm_set1_ps
+#define simd_load _mm_loadu_ps
+#define simd_store _mm_storeu_ps
+#define simd_add _mm_add_ps
+#define simd_sub _mm_sub_ps
+#define simd_mul _mm_mul_ps
+#define simd_div _mm_div_ps
+#define simd_min _mm_min_ps
+#define simd_max _mm_max_ps
+#define simd_sqrt _mm_sqrt_ps
+#endif
+
+#endif /* WITH_SINGLE_PRECISION */
+
+#ifdef SIMD_WIDTH
+#define WITH_SIMD 1
+#endif
+
+#endif /* SIMD_H_ */
@@ -0,0 +1,127 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc_queue.h"
+
+/**
+ * @brief This function creates queue. Capacity is rounded up to power
+ * of two.
+ *
+ * @return Pointer at new queue or NULL on failure
+ */
+struct SPSCQueue *spsc_queue_create(size_t capacity, size_t item_size)
+{
+	struct SPSCQueue *queue = NULL;
+	size_t size = 1;
+
+	while(size < capacity) {
+		size <<= 1;
+	}
+
+	if(posix_memalign((void**)&queue, SPSC_CACHE_LINE, sizeof(struct SPSCQueue)) != 0) {
+		return NULL;
+	}
+
+	queue->items = (char*)malloc(size * item_size);
+	if(queue->items == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->dropped, 0);
+	queue->tail_cache = 0;
+	queue->head_cache = 0;
+	queue->capacity = size;
+	queue->item_size = item_size;
+
+	return queue;
+}
+
+/**
+ * @brief This function adds copy of item to the queue. It has to be called
+ * only from producer thread and it never blocks.
+ *
+ * @return 1 on success, 0, when queue is full and item was dropped
+ */
+int spsc_queue_push(struct SPSCQueue *queue, const void *item)
+{
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+	/* Read index of consumer only, when queue seems to be full */
+	if(tail - queue->head_cache == queue->capacity) {
+		queue->head_cache = atomic_load_explicit(&queue->head, memory_order_acquire);
+		if(tail - queue->head_cache == queue->capacity) {
+			atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+			return 0;
+		}
+	}
+
+	memcpy(queue->items + (tail & (queue->capacity - 1)) * queue->item_size,
+			item, queue->item_size);
+	atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+	return 1;
+}
+
+/**
+ * @brief This function removes the oldest item from the queue. It has to
+ * be called only from consumer thread and it never blocks.
+ *
+ * @return 1 on success, 0, when queue is empty
+ */
+int spsc_queue_pop(struct SPSCQueue *queue, void *item)
+{
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	/* Read index of producer only, when queue seems to be empty */
+	if(head == queue->tail_cache) {
+		queue->tail_cache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+		if(head == queue->tail_cache) {
+			return 0;
+		}
+	}
+
+	memcpy(item, queue->items + (head & (queue->capacity - 1)) * queue->item_size,
+			queue->item_size);
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+	return 1;
+}
+
+/**
+ * @brief This function frees queue and all items in it
+ */
+void spsc_queue_free(struct SPSCQueue *queue)
+{
+	if(queue == NULL) return;
+	if(queue->items != NULL) free(queue->items);
+	free(queue);
+}
@@ -0,0 +1,92 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+/* Size of cache line. Indexes written by different threads are stored
+ * in separate cache lines to avoid false sharing. */
+#define SPSC_CACHE_LINE 64
+
+/**
+ * Lock-free bounded queue of fixed size items with one producer thread
+ * and one consumer thread
+ */
+typedef struct SPSCQueue {
+
+	/**
+	 * Index of next item read by consumer
+	 */
+	_Alignas(SPSC_CACHE_LINE) atomic_size_t head;
+
+	/**
+	 * Copy of tail cached by consumer
+	 */
+	size_t tail_cache;
+
+	/**
+	 * Index of next item written by producer
+	 */
+	_Alignas(SPSC_CACHE_LINE) atomic_size_t tail;
+
+	/**
+	 * Copy of head cached by producer
+	 */
+	size_t head_cache;
+
+	/**
+	 * Number of items rejected, because queue was full
+	 */
+	atomic_uint_fast64_t dropped;
+
+	/**
+	 * Maximal number of items in queue (power of two)
+	 */
+	_Alignas(SPSC_CACHE_LINE) size_t capacity;
+
+	/**
+	 * Size of one item in bytes
+	 */
+	size_t item_size;
+
+	/**
+	 * Buffer of items
+	 */
+	char *items;
+} SPSCQueue;
+
+struct SPSCQueue *spsc_queue_create(size_t capacity, size_t item_size);
+
+int spsc_queue_push(struct SPSCQueue *queue, const void *item);
+
+int spsc_queue_pop(struct SPSCQueue *queue, void *item);
+
+void spsc_queue_free(struct SPSCQueue *queue);
+
+#endif /* SPSC_QUEUE_H_ */
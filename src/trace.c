@@ -0,0 +1,315 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "metrics.h"
+#include "trace.h"
+
+/**
+ * Complete event (span) of Chrome trace format. Name is copied, because
+ * events are written at exit, when most of data is already freed.
+ */
+typedef struct TraceEvent {
+	char name[TRACE_NAME_SIZE];
+	const char *category;
+	uint64_t start;
+	uint64_t duration;
+	int64_t arg;
+} TraceEvent;
+
+/**
+ * Buffer of events of one thread. Only the owner thread adds events.
+ * Blocks are never moved, so events can be written at exit, while
+ * other threads are still running: the number of events is published
+ * after the event is stored.
+ */
+typedef struct TraceBuffer {
+	struct TraceBuffer *next;
+	int tid;
+	char thread_name[TRACE_NAME_SIZE];
+	struct TraceEvent *blocks[TRACE_MAX_BLOCKS];
+	atomic_uint_fast64_t count;
+	uint64_t dropped;
+} TraceBuffer;
+
+/**
+ * Global state of tracing
+ */
+typedef struct Tracer {
+	char *filename;
+	int enabled;
+	atomic_int flushed;
+	uint64_t start;
+	pthread_mutex_t mutex;
+	struct TraceBuffer *buffers;
+	int nbuffers;
+} Tracer;
+
+static struct Tracer tracer = {NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, NULL, 0};
+
+static void trace_atexit(void)
+{
+	trace_flush();
+}
+
+static _Thread_local struct TraceBuffer *thread_buffer = NULL;
+
+/**
+ * @brief This function returns buffer of calling thread. Buffer is
+ * created and registered, when thread adds the first event.
+ */
+static struct TraceBuffer *trace_buffer(void)
+{
+	struct TraceBuffer *buffer = thread_buffer;
+
+	if(buffer != NULL) {
+		return buffer;
+	}
+
+	buffer = (struct TraceBuffer*)calloc(1, sizeof(struct TraceBuffer));
+	if(buffer == NULL) {
+		return NULL;
+	}
+	atomic_init(&buffer->count, 0);
+
+	pthread_mutex_lock(&tracer.mutex);
+	buffer->tid = ++tracer.nbuffers;
+	buffer->next = tracer.buffers;
+	tracer.buffers = buffer;
+	pthread_mutex_unlock(&tracer.mutex);
+
+	thread_buffer = buffer;
+
+	return buffer;
+}
+
+/**
+ * @brief This function enables tracing. Events are written to the file
+ * at exit of program or, when trace_flush() is called.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int trace_init(const char *filename)
+{
+	tracer.filename = strdup(filename);
+	if(tracer.filename == NULL) {
+		return 0;
+	}
+
+	tracer.start = metrics_now();
+	tracer.enabled = 1;
+
+	if(atexit(trace_atexit) != 0) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function returns 1, when tracing is enabled
+ */
+int trace_enabled(void)
+{
+	return tracer.enabled;
+}
+
+/**
+ * @brief This function returns start time of span or 0, when tracing
+ * is disabled
+ */
+uint64_t trace_begin(void)
+{
+	return (tracer.enabled == 1) ? metrics_now() : 0;
+}
+
+/**
+ * @brief This function adds span started by trace_begin() and ended now
+ *
+ * @param name	The name of span (it is truncated to TRACE_NAME_SIZE - 1)
+ * @param category	The category of span (it has to be string literal)
+ * @param arg	The argument of span (e.g. number of items) or -1
+ */
+void trace_end(const char *name, const char *category, uint64_t start, int64_t arg)
+{
+	if(tracer.enabled == 1 && start != 0) {
+		trace_span(name, category, start, metrics_now(), arg);
+	}
+}
+
+/**
+ * @brief This function adds span with given start and end time in
+ * nanoseconds of monotonic clock
+ */
+void trace_span(const char *name, const char *category, uint64_t start, uint64_t end, int64_t arg)
+{
+	struct TraceBuffer *buffer;
+	struct TraceEvent *event;
+	uint64_t count, block;
+
+	if(tracer.enabled == 0 || atomic_load_explicit(&tracer.flushed, memory_order_relaxed) == 1) {
+		return;
+	}
+
+	buffer = trace_buffer();
+	if(buffer == NULL) {
+		return;
+	}
+
+	count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+	block = count / TRACE_BLOCK_EVENTS;
+	if(block >= TRACE_MAX_BLOCKS) {
+		buffer->dropped++;
+		return;
+	}
+	if(buffer->blocks[block] == NULL) {
+		buffer->blocks[block] = (struct TraceEvent*)malloc(
+				TRACE_BLOCK_EVENTS * sizeof(struct TraceEvent));
+		if(buffer->blocks[block] == NULL) {
+			buffer->dropped++;
+			return;
+		}
+	}
+
+	event = &buffer->blocks[block][count % TRACE_BLOCK_EVENTS];
+	strncpy(event->name, name, TRACE_NAME_SIZE - 1);
+	event->name[TRACE_NAME_SIZE - 1] = '\0';
+	event->category = category;
+	event->start = start;
+	event->duration = (end > start) ? end - start : 0;
+	event->arg = arg;
+
+	/* Publish event for thread writing trace at exit */
+	atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+/**
+ * @brief This function sets name of calling thread shown in timeline
+ */
+void trace_thread_name(const char *name)
+{
+	struct TraceBuffer *buffer;
+
+	if(tracer.enabled == 0) {
+		return;
+	}
+
+	buffer = trace_buffer();
+	if(buffer != NULL) {
+		strncpy(buffer->thread_name, name, TRACE_NAME_SIZE - 1);
+	}
+}
+
+/**
+ * @brief This function writes string to JSON file with escaped quotes
+ * and backslashes
+ */
+static void write_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for(; *str != '\0'; str++) {
+		if(*str == '"' || *str == '\\') {
+			fputc('\\', file);
+		}
+		fputc((unsigned char)*str >= 0x20 ? *str : '?', file);
+	}
+	fputc('"', file);
+}
+
+/**
+ * @brief This function writes all buffered events to the file in Chrome
+ * trace event format (it can be opened in chrome://tracing or Perfetto).
+ * Events added after this call are ignored.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int trace_flush(void)
+{
+	struct TraceBuffer *buffer;
+	uint64_t dropped = 0;
+	int first = 1, ret;
+	FILE *file;
+
+	if(tracer.enabled == 0 || atomic_exchange(&tracer.flushed, 1) == 1) {
+		return 1;
+	}
+
+	pthread_mutex_lock(&tracer.mutex);
+
+	file = fopen(tracer.filename, "w");
+	if(file == NULL) {
+		printf("ERROR: Unable to open trace file: %s\n", tracer.filename);
+		pthread_mutex_unlock(&tracer.mutex);
+		return 0;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+	for(buffer = tracer.buffers; buffer != NULL; buffer = buffer->next) {
+		uint64_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+		uint64_t i;
+
+		if(buffer->thread_name[0] != '\0') {
+			fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ",
+					(first == 1) ? "" : ",", buffer->tid);
+			write_string(file, buffer->thread_name);
+			fprintf(file, "}}");
+			first = 0;
+		}
+
+		for(i = 0; i < count; i++) {
+			struct TraceEvent *event = &buffer->blocks[i / TRACE_BLOCK_EVENTS][i % TRACE_BLOCK_EVENTS];
+			int64_t ts = (int64_t)(event->start - tracer.start);
+
+			fprintf(file, "%s\n{\"name\": ", (first == 1) ? "" : ",");
+			write_string(file, event->name);
+			fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+					event->category, buffer->tid, ts * 1e-3, event->duration * 1e-3);
+			if(event->arg >= 0) {
+				fprintf(file, ", \"args\": {\"n\": %ld}", (long)event->arg);
+			}
+			fprintf(file, "}");
+			first = 0;
+		}
+
+		dropped += buffer->dropped;
+	}
+
+	fprintf(file, "\n]}\n");
+	ret = (fclose(file) == 0) ? 1 : 0;
+
+	pthread_mutex_unlock(&tracer.mutex);
+
+	if(dropped > 0) {
+		printf("WARNING: %lu trace events were dropped\n", (unsigned long)dropped);
+	}
+
+	return ret;
+}
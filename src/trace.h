@@ -0,0 +1,54 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/* Number of events in one block of buffer of thread */
+#define TRACE_BLOCK_EVENTS	1024
+
+/* Maximal number of blocks of buffer of one thread */
+#define TRACE_MAX_BLOCKS	4096
+
+/* Maximal length of name of event including terminating zero */
+#define TRACE_NAME_SIZE		32
+
+int trace_init(const char *filename);
+
+int trace_enabled(void);
+
+uint64_t trace_begin(void);
+
+void trace_end(const char *name, const char *category, uint64_t start, int64_t arg);
+
+void trace_span(const char *name, const char *category, uint64_t start, uint64_t end, int64_t arg);
+
+void trace_thread_name(const char *name);
+
+int trace_flush(void);
+
+#endif /* TRACE_H_ */
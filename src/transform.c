@@ -0,0 +1,406 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <verse.h>
+
+#include "main.h"
+#include "simd.h"
+#include "parallel.h"
+#include "bbox.h"
+#include "ply_props.h"
+#include "transform.h"
+
+/**
+ * Data shared by threads transforming vertices. Matrices are stored
+ * in row-major order.
+ */
+typedef struct TransformJob {
+	mesh_real *coords[3];
+	double matrix[16];
+	int is_affine;
+	/* Normals transformed by inverse transpose of 3x3 part of matrix */
+	void *normals;
+	uint8_t normals_type;
+	double normal_matrix[9];
+	/* Faces reversed, when transformation mirrors mesh */
+	uint64_t *quads;
+} TransformJob;
+
+static void matrix_identity(double *m)
+{
+	int i;
+
+	for(i = 0; i < 16; i++) {
+		m[i] = (i % 5 == 0) ? 1.0 : 0.0;
+	}
+}
+
+/**
+ * @brief This function computes: result = a * b
+ */
+static void matrix_multiply(double *result, const double *a, const double *b)
+{
+	double tmp[16];
+	int i, j, k;
+
+	for(i = 0; i < 4; i++) {
+		for(j = 0; j < 4; j++) {
+			tmp[4*i + j] = 0.0;
+			for(k = 0; k < 4; k++) {
+				tmp[4*i + j] += a[4*i + k] * b[4*k + j];
+			}
+		}
+	}
+
+	memcpy(result, tmp, sizeof(tmp));
+}
+
+/**
+ * @brief This function parses permutation of axes like "xzy" or "x-zy".
+ * Letter on position i says, which original axis is used as new axis i.
+ * Optional minus sign negates the axis.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int parse_axes(const char *str, double *m)
+{
+	int axis = 0, sign = 1, used = 0;
+
+	matrix_identity(m);
+	m[0] = m[5] = m[10] = 0.0;
+
+	for(; *str != '\0'; str++) {
+		int src;
+
+		if(*str == '-') {
+			sign = -sign;
+			continue;
+		} else if(*str == '+' || *str == ',') {
+			continue;
+		} else if(*str == 'x' || *str == 'X') {
+			src = 0;
+		} else if(*str == 'y' || *str == 'Y') {
+			src = 1;
+		} else if(*str == 'z' || *str == 'Z') {
+			src = 2;
+		} else {
+			return 0;
+		}
+
+		if(axis >= 3 || (used & (1 << src))) {
+			return 0;
+		}
+
+		m[4*axis + src] = (double)sign;
+		used |= 1 << src;
+		sign = 1;
+		axis++;
+	}
+
+	return (axis == 3) ? 1 : 0;
+}
+
+/**
+ * @brief This function parses 16 comma separated values of matrix
+ * in row-major order.
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int parse_matrix(const char *str, double *m)
+{
+	char *end;
+	int i;
+
+	for(i = 0; i < 16; i++) {
+		m[i] = strtod(str, &end);
+		if(end == str) {
+			return 0;
+		}
+		str = end;
+		while(*str == ',' || *str == ' ') str++;
+	}
+
+	return (*str == '\0') ? 1 : 0;
+}
+
+/**
+ * @brief This function returns 1, when any geometric transformation
+ * of mesh was requested from command line
+ */
+int transform_requested(struct CTX *ctx)
+{
+	return (ctx->recenter != 0 ||
+			ctx->scale != 1.0 ||
+			ctx->my_axes != NULL ||
+			ctx->my_matrix != NULL) ? 1 : 0;
+}
+
+/**
+ * @brief This function transforms vertices [first, last)
+ *
+ * Coordinates are stored in separate arrays, so each row of matrix is
+ * evaluated for SIMD_WIDTH vertices at once with broadcasted elements
+ * of matrix.
+ */
+static void transform_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct TransformJob *job = (struct TransformJob*)arg;
+	mesh_real *vx = job->coords[0];
+	mesh_real *vy = job->coords[1];
+	mesh_real *vz = job->coords[2];
+	const double *m = job->matrix;
+	uint64_t i = first;
+
+	(void)thread_num;
+
+#ifdef WITH_SIMD
+	{
+		simd_real row[16];
+		int k;
+
+		for(k = 0; k < 16; k++) {
+			row[k] = simd_set1((mesh_real)m[k]);
+		}
+
+		for(; i + SIMD_WIDTH <= last; i += SIMD_WIDTH) {
+			simd_real x = simd_load(&vx[i]);
+			simd_real y = simd_load(&vy[i]);
+			simd_real z = simd_load(&vz[i]);
+			simd_real nx, ny, nz;
+
+			nx = simd_add(simd_add(simd_mul(row[0], x), simd_mul(row[1], y)),
+					simd_add(simd_mul(row[2], z), row[3]));
+			ny = simd_add(simd_add(simd_mul(row[4], x), simd_mul(row[5], y)),
+					simd_add(simd_mul(row[6], z), row[7]));
+			nz = simd_add(simd_add(simd_mul(row[8], x), simd_mul(row[9], y)),
+					simd_add(simd_mul(row[10], z), row[11]));
+
+			if(job->is_affine == 0) {
+				simd_real w = simd_add(simd_add(simd_mul(row[12], x), simd_mul(row[13], y)),
+						simd_add(simd_mul(row[14], z), row[15]));
+				nx = simd_div(nx, w);
+				ny = simd_div(ny, w);
+				nz = simd_div(nz, w);
+			}
+
+			simd_store(&vx[i], nx);
+			simd_store(&vy[i], ny);
+			simd_store(&vz[i], nz);
+		}
+	}
+#endif
+
+	for(; i < last; i++) {
+		double x = vx[i], y = vy[i], z = vz[i], w = 1.0;
+
+		if(job->is_affine == 0) {
+			w = m[12]*x + m[13]*y + m[14]*z + m[15];
+		}
+		vx[i] = (mesh_real)((m[0]*x + m[1]*y + m[2]*z + m[3]) / w);
+		vy[i] = (mesh_real)((m[4]*x + m[5]*y + m[6]*z + m[7]) / w);
+		vz[i] = (mesh_real)((m[8]*x + m[9]*y + m[10]*z + m[11]) / w);
+	}
+
+	/* Transform normals loaded from PLY file */
+	if(job->normals != NULL) {
+		const double *n = job->normal_matrix;
+
+		for(i = first; i < last; i++) {
+			double src[3], dst[3], len;
+			int k;
+
+			for(k = 0; k < 3; k++) {
+				src[k] = (job->normals_type == VRS_VALUE_TYPE_REAL32) ?
+						((float*)job->normals)[3*i + k] :
+						((double*)job->normals)[3*i + k];
+			}
+			dst[0] = n[0]*src[0] + n[1]*src[1] + n[2]*src[2];
+			dst[1] = n[3]*src[0] + n[4]*src[1] + n[5]*src[2];
+			dst[2] = n[6]*src[0] + n[7]*src[1] + n[8]*src[2];
+			len = sqrt(dst[0]*dst[0] + dst[1]*dst[1] + dst[2]*dst[2]);
+			len = (len > 0.0) ? 1.0/len : 0.0;
+			for(k = 0; k < 3; k++) {
+				if(job->normals_type == VRS_VALUE_TYPE_REAL32) {
+					((float*)job->normals)[3*i + k] = (float)(dst[k]*len);
+				} else {
+					((double*)job->normals)[3*i + k] = dst[k]*len;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief This function reverses winding of faces [first, last). Swapping
+ * the first and the third index reverses order of vertices of triangle
+ * and quad, and the fourth index of triangles stays zero.
+ */
+static void reverse_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct TransformJob *job = (struct TransformJob*)arg;
+	uint64_t face_id;
+
+	(void)thread_num;
+
+	for(face_id = first; face_id < last; face_id++) {
+		uint64_t *quad = &job->quads[4*face_id];
+		uint64_t tmp = quad[0];
+		quad[0] = quad[2];
+		quad[2] = tmp;
+	}
+}
+
+/**
+ * @brief This function returns determinant of 3x3 part of matrix
+ */
+static double matrix_determinant(const double *m)
+{
+	return m[0]*(m[5]*m[10] - m[6]*m[9]) -
+			m[1]*(m[4]*m[10] - m[6]*m[8]) +
+			m[2]*(m[4]*m[9] - m[5]*m[8]);
+}
+
+/**
+ * @brief This function computes inverse transpose of 3x3 part of matrix
+ * (cofactor matrix). Normals are normalized after transformation, so
+ * the matrix does not have to be divided by determinant, only its sign
+ * matters.
+ */
+static void normal_matrix(double *n, const double *m)
+{
+	double det;
+	int i;
+
+	n[0] = m[5]*m[10] - m[6]*m[9];
+	n[1] = m[6]*m[8] - m[4]*m[10];
+	n[2] = m[4]*m[9] - m[5]*m[8];
+	n[3] = m[2]*m[9] - m[1]*m[10];
+	n[4] = m[0]*m[10] - m[2]*m[8];
+	n[5] = m[1]*m[8] - m[0]*m[9];
+	n[6] = m[1]*m[6] - m[2]*m[5];
+	n[7] = m[2]*m[4] - m[0]*m[6];
+	n[8] = m[0]*m[5] - m[1]*m[4];
+
+	det = matrix_determinant(m);
+	if(det < 0.0) {
+		for(i = 0; i < 9; i++) n[i] = -n[i];
+	}
+}
+
+/**
+ * @brief This function applies geometric transformations requested from
+ * command line to the vertices of mesh. Transformations are composed to
+ * one matrix applied in this order: recentering on bounding box, axis
+ * permutation, uniform scale and user matrix. Mirroring transformation
+ * (negative determinant) reverses winding of faces, so normals computed
+ * from faces keep pointing outside.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int transform_mesh(struct CTX *ctx)
+{
+	struct TransformJob job;
+	struct PropLayer *normals;
+	double tmp[16];
+
+	matrix_identity(job.matrix);
+
+	if(ctx->recenter != 0) {
+		struct BBox bbox;
+		int i;
+
+		if(mesh_bbox(ctx, &bbox) != 1) {
+			return 0;
+		}
+		for(i = 0; i < 3; i++) {
+			job.matrix[4*i + 3] = -0.5*(bbox.min[i] + bbox.max[i]);
+		}
+	}
+
+	if(ctx->my_axes != NULL) {
+		if(parse_axes(ctx->my_axes, tmp) != 1) {
+			printf("ERROR: Wrong permutation of axes: %s\n", ctx->my_axes);
+			return 0;
+		}
+		matrix_multiply(job.matrix, tmp, job.matrix);
+	}
+
+	if(ctx->scale != 1.0) {
+		matrix_identity(tmp);
+		tmp[0] = tmp[5] = tmp[10] = ctx->scale;
+		matrix_multiply(job.matrix, tmp, job.matrix);
+	}
+
+	if(ctx->my_matrix != NULL) {
+		if(parse_matrix(ctx->my_matrix, tmp) != 1) {
+			printf("ERROR: Wrong matrix (16 values expected): %s\n", ctx->my_matrix);
+			return 0;
+		}
+		matrix_multiply(job.matrix, tmp, job.matrix);
+	}
+
+	job.coords[0] = ctx->vx;
+	job.coords[1] = ctx->vy;
+	job.coords[2] = ctx->vz;
+	job.is_affine = (job.matrix[12] == 0.0 && job.matrix[13] == 0.0 &&
+			job.matrix[14] == 0.0 && job.matrix[15] == 1.0) ? 1 : 0;
+
+	job.normals = NULL;
+	normals = ply_props_find(ctx, LAYER_NORMALS_CT);
+	if(normals != NULL && normals->count == 3 &&
+			(normals->data_type == VRS_VALUE_TYPE_REAL32 ||
+			 normals->data_type == VRS_VALUE_TYPE_REAL64)) {
+		job.normals = normals->data;
+		job.normals_type = normals->data_type;
+		normal_matrix(job.normal_matrix, job.matrix);
+	}
+
+	if(ctx->print_debug) {
+		int i;
+		printf("%s(): matrix:\n", __func__);
+		for(i = 0; i < 4; i++) {
+			printf("\t%g, %g, %g, %g\n", job.matrix[4*i + 0], job.matrix[4*i + 1],
+					job.matrix[4*i + 2], job.matrix[4*i + 3]);
+		}
+	}
+
+	if(parallel_for(parallel_threads(ctx->nthreads, ctx->nvertices),
+			ctx->nvertices, transform_range, &job) != 0) {
+		return 0;
+	}
+
+	if(matrix_determinant(job.matrix) < 0.0) {
+		job.quads = ctx->quads;
+		if(parallel_for(parallel_threads(ctx->nthreads, ctx->nquads),
+				ctx->nquads, reverse_range, &job) != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
@@ -0,0 +1,746 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <verse.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "main.h"
+#include "ply_props.h"
+#include "quantize.h"
+#include "render.h"
+#include "metrics.h"
+#include "trace.h"
+#include "verify.h"
+#include "download.h"
+#include "uploader.h"
+
+static struct CTX *ctx = NULL;
+
+/**
+ * @brief This function records phase of session and adds span of interval
+ * finished by this phase to the trace
+ */
+static void session_phase(int phase)
+{
+	struct Metrics *metrics = &ctx->metrics;
+
+	if(metrics_phase_reached(metrics, phase) == 1) {
+		return;
+	}
+
+	metrics_phase(metrics, phase);
+
+	if(phase > 0 && metrics_phase_reached(metrics, phase - 1) == 1) {
+		trace_span(metrics_phase_name(phase - 1), "session",
+				metrics_get(&metrics->phases[phase - 1]),
+				metrics_get(&metrics->phases[phase]), -1);
+	}
+}
+
+/**
+ * @brief This function sends one item of layer to Verse server and counts
+ * it in metrics
+ */
+static inline void send_item(const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value,
+		const size_t size)
+{
+	vrs_send_layer_set_value(ctx->my_session_id,
+			VRS_DEFAULT_PRIORITY,
+			ctx->my_mesh_node_id,
+			layer_id,
+			item_id,
+			data_type,
+			count,
+			value);
+	metrics_add(&ctx->metrics.items_queued, 1);
+	metrics_add(&ctx->metrics.bytes_queued, size);
+}
+
+/**
+ * @brief This function sends all vertices, faces and extra layers
+ * to Verse server. Items are counted to detect, when all of them were
+ * received back from server.
+ */
+static void upload_mesh(void)
+{
+	uint64_t vert_id, quad_id, item_id, start;
+	int i;
+
+	session_phase(METRICS_LAYERS_CREATED);
+	if(ctx->verifier != NULL) {
+		verify_start(ctx->verifier);
+	}
+
+	start = trace_begin();
+	if(ctx->quantization != NULL) {
+		struct Quantization *quant = ctx->quantization;
+		for(vert_id = 0; vert_id < ctx->nvertices; vert_id++ ) {
+			send_item(ctx->my_vertex_layer_id,
+					vert_id,
+					quant->data_type,
+					quant->count,
+					(char*)quant->data + vert_id*quant->item_size,
+					quant->item_size);
+		}
+	} else {
+		for(vert_id = 0; vert_id < ctx->nvertices; vert_id++ ) {
+			/* Vertices are always sent with double precision */
+			double vertex[3];
+			vertex[0] = ctx->vx[vert_id];
+			vertex[1] = ctx->vy[vert_id];
+			vertex[2] = ctx->vz[vert_id];
+			send_item(ctx->my_vertex_layer_id,
+					vert_id,
+					VRS_VALUE_TYPE_REAL64,
+					3,
+					(void*)vertex,
+					sizeof(vertex));
+		}
+	}
+	trace_end("upload vertices", "upload", start, ctx->nvertices);
+
+	start = trace_begin();
+	for(quad_id = 0; quad_id < ctx->nquads; quad_id++) {
+		send_item(ctx->my_face_layer_id,
+				quad_id,
+				VRS_VALUE_TYPE_UINT64,
+				4,
+				(void*)&ctx->quads[4*quad_id],
+				4*sizeof(uint64_t));
+	}
+	trace_end("upload faces", "upload", start, ctx->nquads);
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		struct PropLayer *layer = &ctx->prop_layers[i];
+
+		start = trace_begin();
+		for(item_id = 0; item_id < layer->nitems; item_id++) {
+			send_item(layer->layer_id,
+					item_id,
+					layer->data_type,
+					layer->count,
+					(char*)layer->data + item_id*layer->item_size,
+					layer->item_size);
+		}
+		trace_end(layer->name, "upload", start, layer->nitems);
+	}
+
+	/* Mesh without any item is uploaded immediately */
+	if(metrics_get(&ctx->metrics.items_queued) == 0) {
+		session_phase(METRICS_UPLOAD_DONE);
+	}
+}
+
+/**
+ * @brief This function returns 1, when all layers of mesh were created
+ */
+static int mesh_layers_created(void)
+{
+	int i;
+
+	if(ctx->my_vertex_layer_id == -1 || ctx->my_face_layer_id == -1) {
+		return 0;
+	}
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		if(ctx->prop_layers[i].layer_id == -1) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+/**
+ * @brief The callback function or command layer set_value
+ *
+ * @param session_id
+ * @param node_id
+ * @param layer_id
+ * @param item_id
+ * @param data_type
+ * @param count
+ * @param value
+ */
+static void cb_receive_layer_set_value(const uint8_t session_id,
+	     const uint32_t node_id,
+	     const uint16_t layer_id,
+	     const uint32_t item_id,
+	     const uint8_t data_type,
+	     const uint8_t count,
+	     const void *value)
+{
+	int i;
+
+	/* Item sent by this client was received back from server */
+	if(node_id == ctx->my_mesh_node_id && ctx->mesh_uploaded == 1) {
+		struct Metrics *metrics = &ctx->metrics;
+		if(ctx->verifier != NULL) {
+			verify_store(ctx->verifier, layer_id, item_id, data_type, count, value);
+		}
+		metrics_add(&metrics->items_acked, 1);
+		if(metrics_get(&metrics->items_acked) == metrics_get(&metrics->items_queued)) {
+			session_phase(METRICS_UPLOAD_DONE);
+			printf("upload: items: %lu, bytes: %lu, time: %.3f s\n",
+					(unsigned long)metrics_get(&metrics->items_queued),
+					(unsigned long)metrics_get(&metrics->bytes_queued),
+					metrics_duration(metrics, METRICS_LAYERS_CREATED, METRICS_UPLOAD_DONE));
+		}
+	}
+
+	/* Item of downloaded mesh node */
+	if(ctx->download != NULL) {
+		download_store(ctx->download, node_id, layer_id, item_id, data_type, count, value);
+	}
+
+#if WITH_GLUT
+	/* Pass item to the preview of mesh stored at server */
+	if(ctx->display_live == 1) {
+		render_live_push(ctx, node_id, layer_id, item_id, data_type, count, value);
+	}
+#endif
+
+	if(ctx->print_debug) {
+		printf("%s(): session_id: %u, node_id: %u, layer_id: %d, item_id: %d, data_type: %d, count: %d, value(s): ",
+				__FUNCTION__, session_id, node_id, layer_id, item_id, data_type, count);
+
+		switch(data_type) {
+		case VRS_VALUE_TYPE_UINT8:
+			for(i=0; i<count; i++) {
+				printf("%d, ", ((uint8_t*)value)[i]);
+			}
+			break;
+		case VRS_VALUE_TYPE_UINT16:
+			for(i=0; i<count; i++) {
+				printf("%d, ", ((uint16_t*)value)[i]);
+			}
+			break;
+		case VRS_VALUE_TYPE_UINT32:
+			for(i=0; i<count; i++) {
+				printf("%d, ", ((uint32_t*)value)[i]);
+			}
+			break;
+		case VRS_VALUE_TYPE_UINT64:
+			for(i=0; i<count; i++) {
+#ifdef __APPLE__
+				printf("%llu, ", ((uint64_t*)value)[i]);
+#else
+				printf("%lu, ", ((uint64_t*)value)[i]);
+#endif
+			}
+			break;
+		case VRS_VALUE_TYPE_REAL16:
+			for(i=0; i<count; i++) {
+				/* TODO: convert half-float to float and print it as float value */
+				printf("%x, ", ((uint16_t*)value)[i]);
+			}
+			break;
+		case VRS_VALUE_TYPE_REAL32:
+			for(i=0; i<count; i++) {
+				printf("%6.3f, ", ((float*)value)[i]);
+			}
+			break;
+		case VRS_VALUE_TYPE_REAL64:
+			for(i=0; i<count; i++) {
+				printf("%6.3f, ", ((double*)value)[i]);
+			}
+			break;
+		default:
+			printf("Unknown type");
+			break;
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * @brief The callback function for command tag create
+ *
+ * @param session_id
+ * @param node_id
+ * @param taggroup_id
+ * @param tag_id
+ * @param data_type
+ * @param count
+ * @param custom_type
+ */
+static void cb_receive_tag_create(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t tag_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t custom_type)
+{
+	struct Quantization *quant = ctx->quantization;
+
+	if(ctx->print_debug) {
+		printf("%s(): session_id: %u, node_id: %u, taggroup_id: %d, tag_id: %d, data_type: %d, count: %d, custom_type: %d\n",
+			__FUNCTION__, session_id, node_id, taggroup_id, tag_id, data_type, count, custom_type);
+	}
+
+	if(quant == NULL ||
+			node_id != ctx->my_object_node_id ||
+			taggroup_id != ctx->my_bbox_taggroup_id) {
+		return;
+	}
+
+	switch(custom_type) {
+	case TAG_BBOX_MIN_CT:
+		vrs_send_tag_set_value(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id, tag_id,
+				VRS_VALUE_TYPE_REAL64, 3, quant->bbox.min);
+		break;
+	case TAG_BBOX_MAX_CT:
+		vrs_send_tag_set_value(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id, tag_id,
+				VRS_VALUE_TYPE_REAL64, 3, quant->bbox.max);
+		break;
+	case TAG_QUANT_BITS_CT:
+		{
+			uint8_t bits = (uint8_t)quant->bits;
+			vrs_send_tag_set_value(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id, tag_id,
+					VRS_VALUE_TYPE_UINT8, 1, &bits);
+		}
+		break;
+	case TAG_QUANT_ERROR_CT:
+		vrs_send_tag_set_value(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id, tag_id,
+				VRS_VALUE_TYPE_REAL64, 3, quant->max_error);
+		break;
+	}
+}
+
+/**
+ * @brief The callback function for command tag group create
+ *
+ * @param session_id
+ * @param node_id
+ * @param taggroup_id
+ * @param custom_type
+ */
+static void cb_receive_taggroup_create(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t taggroup_id,
+		const uint16_t custom_type)
+{
+	if(ctx->print_debug) {
+		printf("%s(): session_id: %u, node_id: %u, taggroup_id: %d, custom_type: %d\n",
+			__FUNCTION__, session_id, node_id, taggroup_id, custom_type);
+	}
+
+	if(node_id == ctx->my_object_node_id &&
+			custom_type == TAGGROUP_BBOX_CT &&
+			ctx->my_bbox_taggroup_id == -1) {
+		ctx->my_bbox_taggroup_id = taggroup_id;
+		vrs_send_taggroup_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id, 0, 0);
+		vrs_send_tag_create(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id,
+				VRS_VALUE_TYPE_REAL64, 3, TAG_BBOX_MIN_CT);
+		vrs_send_tag_create(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id,
+				VRS_VALUE_TYPE_REAL64, 3, TAG_BBOX_MAX_CT);
+		vrs_send_tag_create(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id,
+				VRS_VALUE_TYPE_UINT8, 1, TAG_QUANT_BITS_CT);
+		vrs_send_tag_create(session_id, VRS_DEFAULT_PRIORITY, node_id, taggroup_id,
+				VRS_VALUE_TYPE_REAL64, 3, TAG_QUANT_ERROR_CT);
+	}
+}
+
+/**
+ * @brief The callback function or command layer create
+ *
+ * @param session_id
+ * @param node_id
+ * @param parent_layer_id
+ * @param layer_id
+ * @param data_type
+ * @param count
+ * @param custom_type
+ */
+static void cb_receive_layer_create(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint16_t parent_layer_id,
+		const uint16_t layer_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const uint16_t custom_type)
+{
+	if(ctx->print_debug) {
+		printf("%s(): session_id: %u, node_id: %u, parent_layer_id: %d, layer_id: %d, data_type: %d, count: %d, custom_type: %d\n",
+			__FUNCTION__, session_id, node_id, parent_layer_id, layer_id, data_type, count, custom_type);
+	}
+
+	/* Subscribe to vertices and faces of downloaded mesh node */
+	if(ctx->download != NULL) {
+		if(download_layer_create(ctx->download, node_id, layer_id,
+				data_type, count, custom_type) == 1) {
+			vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
+		}
+		return;
+	}
+
+	if(node_id == ctx->my_mesh_node_id && custom_type == LAYER_VERTEXES_CT) {
+		vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
+		ctx->my_vertex_layer_id = layer_id;
+	}
+
+	if(node_id == ctx->my_mesh_node_id && custom_type == LAYER_QUADS_CT) {
+		vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
+		ctx->my_face_layer_id = layer_id;
+	}
+
+	if(node_id == ctx->my_mesh_node_id && custom_type >= LAYER_NORMALS_CT) {
+		struct PropLayer *layer = ply_props_find(ctx, custom_type);
+		if(layer != NULL && layer->layer_id == -1) {
+			vrs_send_layer_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, layer_id, 0, 0);
+			layer->layer_id = layer_id;
+		}
+	}
+
+	if(ctx->mesh_uploaded == 0 && mesh_layers_created() == 1) {
+		/* Start to upload vertices, faces and vertex properties to Verse server */
+		ctx->mesh_uploaded = 1;
+		upload_mesh();
+	}
+}
+
+/**
+ *
+ * @param session_id
+ * @param node_id
+ * @param parent_id
+ * @param user_id
+ * @param custom_type
+ */
+static void cb_receive_node_create(const uint8_t session_id,
+		const uint32_t node_id,
+		const uint32_t parent_id,
+		const uint16_t user_id,
+		const uint16_t custom_type)
+{
+	int i;
+
+	if(ctx->print_debug) {
+		printf("%s() session_id: %d, node_id: %d, parent_id: %d, user_id: %d, custom_type: %d\n",
+			__FUNCTION__, session_id, node_id, parent_id, user_id, custom_type);
+	}
+
+	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, node_id, 0, 0);
+
+	if(parent_id == ctx->my_avatar_id && custom_type == OBJECT_NODE_CT) {
+		ctx->my_object_node_id = node_id;
+		vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, VRS_SCENE_PARENT_NODE_ID, node_id);
+		if(ctx->my_mesh_node_id != -1) {
+			vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, ctx->my_object_node_id, node_id);
+		}
+		/* Store bounding box needed for decoding of quantized vertices */
+		if(ctx->quantization != NULL) {
+			vrs_send_taggroup_create(session_id, VRS_DEFAULT_PRIORITY, node_id, TAGGROUP_BBOX_CT);
+		}
+	}
+
+	if(parent_id == ctx->my_avatar_id && custom_type == MESH_NODE_CT) {
+		ctx->my_mesh_node_id = node_id;
+		if(ctx->my_object_node_id != -1) {
+			vrs_send_node_link(session_id, VRS_DEFAULT_PRIORITY, ctx->my_object_node_id, node_id);
+		}
+		if(ctx->quantization != NULL) {
+			vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1,
+					ctx->quantization->data_type, ctx->quantization->count, LAYER_VERTEXES_CT);
+		} else {
+			vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_REAL64, 3, LAYER_VERTEXES_CT);
+		}
+		vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_UINT64, 2, LAYER_EDGES_CT);
+		vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1, VRS_VALUE_TYPE_UINT64, 4, LAYER_QUADS_CT);
+		for(i = 0; i < ctx->nprop_layers; i++) {
+			struct PropLayer *layer = &ctx->prop_layers[i];
+			vrs_send_layer_create(session_id, VRS_DEFAULT_PRIORITY, node_id, -1,
+					layer->data_type, layer->count, layer->custom_type);
+		}
+	}
+
+	if(ctx->my_object_node_id != -1 && ctx->my_mesh_node_id != -1) {
+		session_phase(METRICS_NODES_CREATED);
+	}
+}
+
+/**
+ * @brief Callback function for user authentication
+ *
+ * @param session_id
+ * @param username
+ * @param auth_methods_count
+ * @param methods
+ */
+static void cb_receive_user_authenticate(const uint8_t session_id,
+		const char *username,
+		const uint8_t auth_methods_count,
+		const uint8_t *methods)
+{
+	static int attempts = 0;	/* Store number of authentication attempt for this session. */
+	char name[VRS_MAX_USERNAME_LENGTH + 1];
+	char *password;
+	int i, is_passwd_supported = 0;
+
+	/* Debug print */
+	if(ctx->print_debug) {
+		printf("%s() username: %s, auth_methods_count: %d, methods: ",
+				__FUNCTION__, username, auth_methods_count);
+		for(i = 0; i < auth_methods_count; i++) {
+			printf("%d, ", methods[i]);
+		}
+		printf("\n");
+	}
+
+	session_phase(METRICS_AUTHENTICATE);
+
+	for(i = 0; i < auth_methods_count; i++) {
+		if(methods[i] == VRS_UA_METHOD_PASSWORD) {
+			is_passwd_supported = 1;
+		}
+	}
+
+	/* Get username, when it is requested */
+	if(username == NULL) {
+		int ret = 0;
+		attempts = 0;	/* Reset counter of auth. attempt. */
+		if(ctx->my_username != NULL) {
+			vrs_send_user_authenticate(session_id, ctx->my_username, 0, NULL);
+		} else {
+			printf("Username: ");
+			ret = scanf("%s", name);
+			if(ret == 1) {
+				vrs_send_user_authenticate(session_id, name, 0, NULL);
+			} else {
+				printf("ERROR: Reading username.\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+	} else {
+		if(is_passwd_supported == 1) {
+			attempts++;
+			strncpy(name, username, VRS_MAX_USERNAME_LENGTH);
+			if(ctx->my_password != NULL && attempts == 1) {
+				vrs_send_user_authenticate(session_id, name,
+						VRS_UA_METHOD_PASSWORD, ctx->my_password);
+			} else {
+				/* Print this warning, when previous authentication attempt failed. */
+				if(attempts > 1)
+					printf("Permission denied, please try again.\n");
+				/* Get password from user */
+				password = getpass("Password: ");
+				vrs_send_user_authenticate(session_id, name, VRS_UA_METHOD_PASSWORD, password);
+			}
+		} else {
+			printf("ERROR: Verse server does not support password authentication method\n");
+		}
+	}
+}
+
+/**
+ * @brief Callback function for connect accept
+ *
+ * @param session_id
+ * @param user_id
+ * @param avatar_id
+ */
+static void cb_receive_connect_accept(const uint8_t session_id,
+		const uint16_t user_id,
+		const uint32_t avatar_id)
+{
+	if(ctx->print_debug) {
+		printf("%s() session_id: %d, user_id: %d, avatar_id: %d\n",
+			__FUNCTION__, session_id, user_id, avatar_id);
+	}
+
+	ctx->my_avatar_id = avatar_id;
+	ctx->my_user_id = user_id;
+	session_phase(METRICS_CONNECT_ACCEPT);
+
+	/* When client receive connect accept, then it is ready to subscribe
+	 * to the root node of the node tree. Id of root node is still 0. This
+	 * function is called with level 1. It means, that this client will be
+	 * subscribed to the root node and its child nodes (1, 2, 3) */
+	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, 0, 0, 0);
+
+	/* Check if server allow double subscribe? */
+	vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, 1, 0, 0);
+
+	/* Subscribe to existing mesh node instead of upload */
+	if(ctx->download != NULL) {
+		vrs_send_node_subscribe(session_id, VRS_DEFAULT_PRIORITY, ctx->download->node_id, 0, 0);
+		download_start(ctx->download);
+		return;
+	}
+
+	/* Try to create new nodes */
+	vrs_send_node_create(session_id, VRS_DEFAULT_PRIORITY, OBJECT_NODE_CT);
+	vrs_send_node_create(session_id, VRS_DEFAULT_PRIORITY, MESH_NODE_CT);
+}
+
+/**
+ * @brief Callback function for connect terminate
+ *
+ * @param session_id
+ * @param error_num
+ */
+static void cb_receive_connect_terminate(const uint8_t session_id,
+		const uint8_t error_num)
+{
+	if(ctx->print_debug) {
+		printf("%s() session_id: %d, error_num: %d\n",
+			__FUNCTION__, session_id, error_num);
+		switch(error_num) {
+		case VRS_CONN_TERM_AUTH_FAILED:
+			printf("User authentication failed\n");
+			break;
+		case VRS_CONN_TERM_HOST_DOWN:
+			printf("Host is not accessible\n");
+			break;
+		case VRS_CONN_TERM_HOST_UNKNOWN:
+			printf("Host could not be found\n");
+			break;
+		case VRS_CONN_TERM_SERVER_DOWN:
+			printf("Server is not running\n");
+			break;
+		case VRS_CONN_TERM_TIMEOUT:
+			printf("Connection timeout\n");
+			break;
+		case VRS_CONN_TERM_ERROR:
+			printf("Connection with server was broken\n");
+			break;
+		case VRS_CONN_TERM_SERVER:
+			printf("Connection was terminated by server\n");
+			break;
+		case VRS_CONN_TERM_CLIENT:
+			printf("Connection was terminated by client\n");
+			break;
+		default:
+			printf("Unknown error\n");
+			break;
+		}
+	}
+	ctx->session_running = 0;
+}
+
+/**
+ * @brief This function connects to Verse server, uploads mesh and runs
+ * main loop of client. The loop is left, when connection is terminated.
+ * When ctx->exit_after_upload is set, then connection is terminated by
+ * client, when all items of mesh were received back from server. When
+ * ctx->verifier is set, then received items are compared with source
+ * mesh. When ctx->download is set, then existing mesh node is written
+ * to PLY file instead of upload.
+ *
+ * @return 1 on success, 0 on failure
+ */
+int uploader_session(struct CTX *_ctx)
+{
+	unsigned short flags = VRS_SEC_DATA_NONE;
+	int error_num, terminating = 0, ret = 1;
+
+	ctx = _ctx;
+
+	/* Allocate buffers for all items received back from server */
+	if(ctx->verify == 1 && ctx->download == NULL) {
+		ctx->verifier = verify_create(ctx);
+		if(ctx->verifier == NULL) {
+			printf("ERROR: Unable to allocate buffers for verification\n");
+			return 0;
+		}
+	}
+
+	/* Register basic callback functions */
+	vrs_register_receive_user_authenticate(cb_receive_user_authenticate);
+	vrs_register_receive_connect_accept(cb_receive_connect_accept);
+	vrs_register_receive_connect_terminate(cb_receive_connect_terminate);
+
+	vrs_register_receive_node_create(cb_receive_node_create);
+	vrs_register_receive_taggroup_create(cb_receive_taggroup_create);
+	vrs_register_receive_tag_create(cb_receive_tag_create);
+	vrs_register_receive_layer_create(cb_receive_layer_create);
+	vrs_register_receive_layer_set_value(cb_receive_layer_set_value);
+
+	/* Send connect request to the server */
+	session_phase(METRICS_CONNECT_REQUEST);
+	error_num = vrs_send_connect_request(ctx->my_verse_server, "12345", flags, &ctx->my_session_id);
+	if(error_num != VRS_SUCCESS) {
+		printf("ERROR: %s\n", vrs_strerror(error_num));
+		return 0;
+	}
+	ctx->session_running = 1;
+
+	while(ctx->session_running == 1) {
+		uint64_t start = trace_begin();
+		uint64_t acked = metrics_get(&ctx->metrics.items_acked);
+
+		/* Items received back are counted in one span, because span
+		 * of each item would be more expensive than its handling */
+		vrs_callback_update(ctx->my_session_id);
+		trace_end("vrs_callback_update", "callback", start,
+				(int64_t)(metrics_get(&ctx->metrics.items_acked) - acked));
+		/* Compare mesh received back from server with source mesh */
+		if(ctx->verifier != NULL && ctx->verifier->done == 0 &&
+				metrics_phase_reached(&ctx->metrics, METRICS_UPLOAD_DONE) == 1) {
+			ret &= verify_run(ctx->verifier, ctx);
+		}
+		/* Report missing items and fail, when server does not send
+		 * any items back, e.g. it dropped or rejected them */
+		if(ctx->verifier != NULL && ctx->verifier->done == 0 && terminating == 0 &&
+				verify_idle(ctx->verifier, metrics_get(&ctx->metrics.items_acked)) == 1) {
+			printf("ERROR: No item was received back from server for %g s\n",
+					ctx->verifier->idle_timeout);
+			verify_run(ctx->verifier, ctx);
+			ret = 0;
+			vrs_send_connect_terminate(ctx->my_session_id);
+			terminating = 1;
+		}
+		if(ctx->exit_after_upload == 1 && ctx->download == NULL && terminating == 0 &&
+				metrics_phase_reached(&ctx->metrics, METRICS_UPLOAD_DONE) == 1) {
+			vrs_send_connect_terminate(ctx->my_session_id);
+			terminating = 1;
+		}
+		/* Write downloaded mesh, when server does not send any items */
+		if(ctx->download != NULL && terminating == 0 &&
+				download_idle(ctx->download) == 1) {
+			ret &= download_write(ctx->download);
+			vrs_send_connect_terminate(ctx->my_session_id);
+			terminating = 1;
+		}
+		usleep(1000000/FPS);
+	}
+
+	/* Report missing items, when connection was terminated before
+	 * all items were received back */
+	if(ctx->verifier != NULL && ctx->verifier->done == 0) {
+		ret &= verify_run(ctx->verifier, ctx);
+	}
+
+	return ret;
+}
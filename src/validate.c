@@ -0,0 +1,351 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <verse.h>
+
+#include "main.h"
+#include "parallel.h"
+#include "bbox.h"
+#include "trace.h"
+#include "validate.h"
+
+/* Problems of face found by validation */
+#define FACE_OK         0
+#define FACE_INVALID    1
+#define FACE_NONFINITE  2
+#define FACE_DEGENERATE 3
+
+/**
+ * Statistics of mesh computed by validation
+ */
+typedef struct MeshStats {
+	/* Bounding box of vertices with finite coordinates */
+	struct BBox bbox;
+	/* Number of vertices with NaN or infinite coordinate */
+	uint64_t nonfinite_vertices;
+	/* Number of faces by number of vertices (3 and 4) */
+	uint64_t arity[5];
+	/* Number of faces with index out of range of vertices */
+	uint64_t invalid_faces;
+	/* Number of faces using vertex with non-finite coordinate */
+	uint64_t nonfinite_faces;
+	/* Number of faces with repeated index or zero area */
+	uint64_t degenerate_faces;
+} MeshStats;
+
+/**
+ * Data shared by threads validating mesh
+ */
+typedef struct ValidateJob {
+	struct CTX *ctx;
+	/* Per-thread statistics */
+	struct MeshStats *stats;
+	/* Problem of each face or NULL, when it is not needed */
+	uint8_t *problems;
+} ValidateJob;
+
+/**
+ * @brief This function returns 1, when all coordinates of vertex are finite
+ */
+static inline int vertex_is_finite(const struct CTX *ctx, uint64_t i)
+{
+	return (isfinite(ctx->vx[i]) && isfinite(ctx->vy[i]) && isfinite(ctx->vz[i])) ? 1 : 0;
+}
+
+/**
+ * @brief This function checks one face with n vertices. Area of face is
+ * computed from cross product of edges of triangle or diagonals of quad
+ * like in normals.c.
+ *
+ * @return FACE_OK or the first problem found
+ */
+static int check_face(const struct CTX *ctx, const uint64_t *quad, int n)
+{
+	const mesh_real *vx = ctx->vx;
+	const mesh_real *vy = ctx->vy;
+	const mesh_real *vz = ctx->vz;
+	int j, k;
+	double e1[3], e2[3], normal[3];
+	uint64_t a, b, c, d;
+
+	for(j = 0; j < n; j++) {
+		if(quad[j] >= ctx->nvertices) return FACE_INVALID;
+	}
+
+	for(j = 0; j < n; j++) {
+		if(vertex_is_finite(ctx, quad[j]) == 0) return FACE_NONFINITE;
+	}
+
+	for(j = 0; j < n; j++) {
+		for(k = j + 1; k < n; k++) {
+			if(quad[j] == quad[k]) return FACE_DEGENERATE;
+		}
+	}
+
+	a = quad[0];
+	b = quad[1];
+	c = quad[2];
+
+	if(n == 3) {
+		e1[0] = vx[b] - vx[a]; e1[1] = vy[b] - vy[a]; e1[2] = vz[b] - vz[a];
+		e2[0] = vx[c] - vx[a]; e2[1] = vy[c] - vy[a]; e2[2] = vz[c] - vz[a];
+	} else {
+		d = quad[3];
+		e1[0] = vx[c] - vx[a]; e1[1] = vy[c] - vy[a]; e1[2] = vz[c] - vz[a];
+		e2[0] = vx[d] - vx[b]; e2[1] = vy[d] - vy[b]; e2[2] = vz[d] - vz[b];
+	}
+
+	normal[0] = e1[1]*e2[2] - e1[2]*e2[1];
+	normal[1] = e1[2]*e2[0] - e1[0]*e2[2];
+	normal[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+	if(normal[0] == 0.0 && normal[1] == 0.0 && normal[2] == 0.0) {
+		return FACE_DEGENERATE;
+	}
+
+	return FACE_OK;
+}
+
+/**
+ * @brief This function counts non-finite vertices [first, last) and
+ * computes bounding box of the finite ones
+ */
+static void validate_vertices(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct ValidateJob *job = (struct ValidateJob*)arg;
+	struct CTX *ctx = job->ctx;
+	struct MeshStats *stats = &job->stats[thread_num];
+	uint64_t i;
+
+	for(i = first; i < last; i++) {
+		if(vertex_is_finite(ctx, i) == 0) {
+			stats->nonfinite_vertices++;
+			continue;
+		}
+		stats->bbox.min[0] = fmin(stats->bbox.min[0], ctx->vx[i]);
+		stats->bbox.min[1] = fmin(stats->bbox.min[1], ctx->vy[i]);
+		stats->bbox.min[2] = fmin(stats->bbox.min[2], ctx->vz[i]);
+		stats->bbox.max[0] = fmax(stats->bbox.max[0], ctx->vx[i]);
+		stats->bbox.max[1] = fmax(stats->bbox.max[1], ctx->vy[i]);
+		stats->bbox.max[2] = fmax(stats->bbox.max[2], ctx->vz[i]);
+	}
+}
+
+/**
+ * @brief This function checks faces [first, last) and counts them by
+ * number of vertices and by problem
+ */
+static void validate_faces(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct ValidateJob *job = (struct ValidateJob*)arg;
+	struct CTX *ctx = job->ctx;
+	struct MeshStats *stats = &job->stats[thread_num];
+	uint64_t face_id;
+
+	for(face_id = first; face_id < last; face_id++) {
+		const uint64_t *quad = &ctx->quads[4*face_id];
+		int n = ctx->face_sizes[face_id];
+		int problem = check_face(ctx, quad, n);
+
+		stats->arity[n]++;
+
+		switch(problem) {
+		case FACE_INVALID:
+			stats->invalid_faces++;
+			break;
+		case FACE_NONFINITE:
+			stats->nonfinite_faces++;
+			break;
+		case FACE_DEGENERATE:
+			stats->degenerate_faces++;
+			break;
+		}
+
+		if(job->problems != NULL) {
+			job->problems[face_id] = (uint8_t)problem;
+		}
+	}
+}
+
+/**
+ * @brief This function computes statistics of mesh: bounding box of finite
+ * vertices, histogram of number of vertices of faces and number of faces
+ * with invalid index, non-finite vertex or zero area.
+ *
+ * @param problems	The array of problems of faces or NULL
+ * @return 1 on success, 0 on failure
+ */
+static int mesh_stats(struct CTX *ctx, struct MeshStats *stats, uint8_t *problems)
+{
+	struct ValidateJob job;
+	int nthreads, t, k;
+
+	nthreads = parallel_threads(ctx->nthreads,
+			(ctx->nvertices > ctx->nquads) ? ctx->nvertices : ctx->nquads);
+
+	job.ctx = ctx;
+	job.problems = problems;
+	job.stats = (struct MeshStats*)calloc(nthreads, sizeof(struct MeshStats));
+	if(job.stats == NULL) {
+		return 0;
+	}
+	for(t = 0; t < nthreads; t++) {
+		for(k = 0; k < 3; k++) {
+			job.stats[t].bbox.min[k] = DBL_MAX;
+			job.stats[t].bbox.max[k] = -DBL_MAX;
+		}
+	}
+
+	if(parallel_for(nthreads, ctx->nvertices, validate_vertices, &job) != 0 ||
+			parallel_for(nthreads, ctx->nquads, validate_faces, &job) != 0) {
+		free(job.stats);
+		return 0;
+	}
+
+	memcpy(stats, &job.stats[0], sizeof(struct MeshStats));
+	for(t = 1; t < nthreads; t++) {
+		for(k = 0; k < 3; k++) {
+			stats->bbox.min[k] = fmin(stats->bbox.min[k], job.stats[t].bbox.min[k]);
+			stats->bbox.max[k] = fmax(stats->bbox.max[k], job.stats[t].bbox.max[k]);
+		}
+		stats->nonfinite_vertices += job.stats[t].nonfinite_vertices;
+		for(k = 0; k < 5; k++) {
+			stats->arity[k] += job.stats[t].arity[k];
+		}
+		stats->invalid_faces += job.stats[t].invalid_faces;
+		stats->nonfinite_faces += job.stats[t].nonfinite_faces;
+		stats->degenerate_faces += job.stats[t].degenerate_faces;
+	}
+	free(job.stats);
+
+	return 1;
+}
+
+/**
+ * @brief This function removes faces with any problem and resets
+ * non-finite coordinates to zero. Order of remaining faces is kept.
+ *
+ * @return Number of removed faces
+ */
+static uint64_t repair_mesh(struct CTX *ctx, const uint8_t *problems)
+{
+	uint64_t i, face_id, nquads = 0;
+
+	for(i = 0; i < ctx->nvertices; i++) {
+		if(vertex_is_finite(ctx, i) == 0) {
+			ctx->vx[i] = ctx->vy[i] = ctx->vz[i] = 0;
+		}
+	}
+
+	for(face_id = 0; face_id < ctx->nquads; face_id++) {
+		if(problems[face_id] != FACE_OK) continue;
+		if(nquads != face_id) {
+			memcpy(&ctx->quads[4*nquads], &ctx->quads[4*face_id], 4*sizeof(uint64_t));
+			ctx->face_sizes[nquads] = ctx->face_sizes[face_id];
+		}
+		nquads++;
+	}
+
+	i = ctx->nquads - nquads;
+	ctx->nquads = nquads;
+
+	return i;
+}
+
+/**
+ * @brief This function prints statistics of mesh
+ */
+static void print_stats(const struct MeshStats *stats)
+{
+	printf("validate: non-finite vertices: %lu, bbox: (%g, %g, %g) - (%g, %g, %g)\n",
+			(unsigned long)stats->nonfinite_vertices,
+			stats->bbox.min[0], stats->bbox.min[1], stats->bbox.min[2],
+			stats->bbox.max[0], stats->bbox.max[1], stats->bbox.max[2]);
+	printf("validate: triangles: %lu, quads: %lu, invalid index: %lu, non-finite vertex: %lu, degenerate: %lu\n",
+			(unsigned long)stats->arity[3], (unsigned long)stats->arity[4],
+			(unsigned long)stats->invalid_faces, (unsigned long)stats->nonfinite_faces,
+			(unsigned long)stats->degenerate_faces);
+}
+
+/**
+ * @brief This function validates loaded mesh before anything is derived
+ * from it or sent to server. Indices out of range and non-finite
+ * coordinates are errors, faces with zero area are only reported. When
+ * repair was requested, all faces with any problem are removed and
+ * non-finite coordinates are reset to zero instead.
+ *
+ * @return 1, when mesh can be uploaded, 0 otherwise
+ */
+int validate_mesh(struct CTX *ctx)
+{
+	struct MeshStats stats;
+	uint8_t *problems = NULL;
+	uint64_t start = trace_begin(), removed;
+
+	if(ctx->repair == 1) {
+		problems = (uint8_t*)malloc(ctx->nquads * sizeof(uint8_t));
+		if(problems == NULL && ctx->nquads > 0) {
+			printf("ERROR: Out of memory\n");
+			return 0;
+		}
+	}
+
+	if(mesh_stats(ctx, &stats, problems) != 1) {
+		printf("ERROR: Unable to validate mesh\n");
+		free(problems);
+		return 0;
+	}
+	trace_end("validate", "load", start, ctx->nvertices + ctx->nquads);
+
+	print_stats(&stats);
+
+	if(stats.nonfinite_vertices == 0 && stats.invalid_faces == 0 &&
+			stats.nonfinite_faces == 0 && stats.degenerate_faces == 0) {
+		free(problems);
+		return 1;
+	}
+
+	if(ctx->repair == 1) {
+		removed = repair_mesh(ctx, problems);
+		free(problems);
+		printf("validate: removed faces: %lu, reset vertices: %lu\n",
+				(unsigned long)removed, (unsigned long)stats.nonfinite_vertices);
+		return 1;
+	}
+
+	if(stats.nonfinite_vertices > 0 || stats.invalid_faces > 0 || stats.nonfinite_faces > 0) {
+		printf("ERROR: Mesh contains invalid indices or non-finite coordinates (use --repair to remove them)\n");
+		return 0;
+	}
+
+	printf("WARNING: Mesh contains %lu degenerate faces\n", (unsigned long)stats.degenerate_faces);
+
+	return 1;
+}
@@ -0,0 +1,378 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <verse.h>
+
+#include "main.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "quantize.h"
+#include "ply_props.h"
+#include "verify.h"
+
+/* Offset basis and prime of 64-bit FNV-1a hash */
+#define CHECKSUM_BASIS	14695981039346656037ULL
+#define CHECKSUM_PRIME	1099511628211ULL
+
+/**
+ * Data shared by threads computing checksums of blocks of one layer
+ */
+typedef struct VerifyJob {
+	struct CTX *ctx;
+	struct VerifyLayer *layer;
+	/* Index of layer: 0 = vertices, 1 = faces, 2+ = vertex properties */
+	int index;
+	/* Per-block checksums of source items and received items */
+	uint64_t *source_sums;
+	uint64_t *received_sums;
+} VerifyJob;
+
+/**
+ * @brief This function adds bytes of one item to the checksum. Item is
+ * processed by 64-bit words, like FNV-1a processes bytes, with extra
+ * shift to propagate high bits of words.
+ */
+static inline uint64_t checksum_update(uint64_t hash, const unsigned char *data, size_t size)
+{
+	size_t i = 0;
+
+	for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(uint64_t));
+		hash = (hash ^ word) * CHECKSUM_PRIME;
+		hash ^= hash >> 29;
+	}
+	for(; i < size; i++) {
+		hash = (hash ^ data[i]) * CHECKSUM_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief This function returns item of source mesh encoded in the same
+ * way, as it is sent to server
+ *
+ * @param vertex	The buffer used for vertices sent with double precision
+ */
+static const unsigned char *source_item(struct CTX *ctx, int index,
+		uint64_t item_id, double *vertex)
+{
+	if(index == 0) {
+		struct Quantization *quant = ctx->quantization;
+		if(quant != NULL) {
+			return (const unsigned char*)quant->data + item_id*quant->item_size;
+		}
+		vertex[0] = ctx->vx[item_id];
+		vertex[1] = ctx->vy[item_id];
+		vertex[2] = ctx->vz[item_id];
+		return (const unsigned char*)vertex;
+	} else if(index == 1) {
+		return (const unsigned char*)&ctx->quads[4*item_id];
+	} else {
+		struct PropLayer *layer = &ctx->prop_layers[index - 2];
+		return (const unsigned char*)layer->data + item_id*layer->item_size;
+	}
+}
+
+/**
+ * @brief This function computes checksums of blocks [first, last) of
+ * source and received items
+ */
+static void verify_range(void *arg, int thread_num, uint64_t first, uint64_t last)
+{
+	struct VerifyJob *job = (struct VerifyJob*)arg;
+	struct VerifyLayer *layer = job->layer;
+	uint64_t block;
+
+	(void)thread_num;
+
+	for(block = first; block < last; block++) {
+		uint64_t begin = block * VERIFY_BLOCK_ITEMS;
+		uint64_t end = begin + VERIFY_BLOCK_ITEMS;
+		uint64_t source_sum = CHECKSUM_BASIS, received_sum = CHECKSUM_BASIS;
+		uint64_t i;
+
+		if(end > layer->nitems) end = layer->nitems;
+
+		for(i = begin; i < end; i++) {
+			double vertex[3];
+			source_sum = checksum_update(source_sum,
+					source_item(job->ctx, job->index, i, vertex),
+					layer->item_size);
+			received_sum = checksum_update(received_sum,
+					layer->data + i*layer->item_size,
+					layer->item_size);
+		}
+
+		job->source_sums[block] = source_sum;
+		job->received_sums[block] = received_sum;
+	}
+}
+
+/**
+ * @brief This function adds layer to the verification
+ *
+ * @return 1 on success, 0 on failure
+ */
+static int verify_add_layer(struct Verifier *verifier,
+		const char *name,
+		const int64_t *layer_id,
+		uint8_t data_type,
+		uint8_t count,
+		uint64_t nitems)
+{
+	struct VerifyLayer *layer = &verifier->layers[verifier->nlayers];
+
+	layer->name = name;
+	layer->layer_id = layer_id;
+	layer->data_type = data_type;
+	layer->count = count;
+	layer->item_size = value_type_size(data_type) * count;
+	layer->nitems = nitems;
+	layer->data = (unsigned char*)calloc(nitems, layer->item_size);
+	layer->received = (uint64_t*)calloc((nitems + 63) / 64, sizeof(uint64_t));
+	verifier->nlayers++;
+
+	if(nitems > 0 && (layer->data == NULL || layer->received == NULL)) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief This function allocates buffers for all items of mesh received
+ * back from server. It has to be called after mesh is prepared for upload.
+ *
+ * @return Pointer at verifier or NULL on failure
+ */
+struct Verifier *verify_create(struct CTX *ctx)
+{
+	struct Verifier *verifier;
+	int ret, i;
+
+	verifier = (struct Verifier*)calloc(1, sizeof(struct Verifier));
+	if(verifier == NULL) {
+		return NULL;
+	}
+	verifier->idle_timeout = ctx->idle_timeout;
+
+	if(ctx->quantization != NULL) {
+		ret = verify_add_layer(verifier, "vertices", &ctx->my_vertex_layer_id,
+				ctx->quantization->data_type, ctx->quantization->count,
+				ctx->nvertices);
+	} else {
+		ret = verify_add_layer(verifier, "vertices", &ctx->my_vertex_layer_id,
+				VRS_VALUE_TYPE_REAL64, 3, ctx->nvertices);
+	}
+	ret &= verify_add_layer(verifier, "faces", &ctx->my_face_layer_id,
+			VRS_VALUE_TYPE_UINT64, 4, ctx->nquads);
+
+	for(i = 0; i < ctx->nprop_layers; i++) {
+		struct PropLayer *layer = &ctx->prop_layers[i];
+		ret &= verify_add_layer(verifier, layer->name, &layer->layer_id,
+				layer->data_type, layer->count, layer->nitems);
+	}
+
+	if(ret != 1) {
+		verify_destroy(verifier);
+		return NULL;
+	}
+
+	return verifier;
+}
+
+/**
+ * @brief This function stores item received from server. Items of other
+ * layers are ignored. It does not allocate any memory.
+ */
+void verify_store(struct Verifier *verifier,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value)
+{
+	struct VerifyLayer *layer = NULL;
+	uint64_t bit;
+	int i;
+
+	for(i = 0; i < verifier->nlayers; i++) {
+		if(*verifier->layers[i].layer_id == (int64_t)layer_id) {
+			layer = &verifier->layers[i];
+			break;
+		}
+	}
+
+	if(layer == NULL) {
+		return;
+	}
+
+	if(item_id >= layer->nitems || data_type != layer->data_type || count != layer->count) {
+		layer->nunexpected++;
+		return;
+	}
+
+	memcpy(layer->data + (uint64_t)item_id*layer->item_size, value, layer->item_size);
+
+	bit = (uint64_t)1 << (item_id % 64);
+	if((layer->received[item_id / 64] & bit) == 0) {
+		layer->received[item_id / 64] |= bit;
+		layer->nreceived++;
+	}
+}
+
+/**
+ * @brief This function starts measuring of time without received items.
+ * It has to be called, when layers are created and upload of items starts.
+ */
+void verify_start(struct Verifier *verifier)
+{
+	verifier->last_acked = 0;
+	verifier->last_time = metrics_now();
+}
+
+/**
+ * @brief This function checks, if any item was received back from server
+ * since last call. Timeout is not measured before verify_start().
+ *
+ * @param acked	The number of items received back from server
+ * @return 1, when no item was received for idle timeout, 0 otherwise
+ */
+int verify_idle(struct Verifier *verifier, uint64_t acked)
+{
+	uint64_t now;
+
+	/* Upload of items was not started yet */
+	if(verifier->last_time == 0) return 0;
+
+	now = metrics_now();
+	if(acked != verifier->last_acked) {
+		verifier->last_acked = acked;
+		verifier->last_time = now;
+		return 0;
+	}
+
+	return ((now - verifier->last_time) * 1e-9 >= verifier->idle_timeout) ? 1 : 0;
+}
+
+/**
+ * @brief This function compares checksums of blocks of received items
+ * with checksums of blocks of uploaded items and it prints report for
+ * each layer. Uploaded mesh is the mesh in memory after processing
+ * (transformation, quantization and reordering to meshlets), not the
+ * PLY file itself.
+ *
+ * @return 1, when mesh stored at server matches source mesh, 0 otherwise
+ */
+int verify_run(struct Verifier *verifier, struct CTX *ctx)
+{
+	int i, ret = 1;
+
+	verifier->done = 1;
+
+	for(i = 0; i < verifier->nlayers; i++) {
+		struct VerifyLayer *layer = &verifier->layers[i];
+		uint64_t nblocks = (layer->nitems + VERIFY_BLOCK_ITEMS - 1) / VERIFY_BLOCK_ITEMS;
+		uint64_t block, mismatched = 0, first_item = 0;
+		struct VerifyJob job;
+
+		job.ctx = ctx;
+		job.layer = layer;
+		job.index = i;
+		job.source_sums = (uint64_t*)calloc(nblocks + 1, sizeof(uint64_t));
+		job.received_sums = (uint64_t*)calloc(nblocks + 1, sizeof(uint64_t));
+		if(job.source_sums == NULL || job.received_sums == NULL ||
+				parallel_for(parallel_threads(ctx->nthreads, layer->nitems),
+						nblocks, verify_range, &job) != 0) {
+			printf("ERROR: Unable to compute checksums of layer: %s\n", layer->name);
+			free(job.source_sums);
+			free(job.received_sums);
+			return 0;
+		}
+
+		for(block = 0; block < nblocks; block++) {
+			if(job.source_sums[block] != job.received_sums[block]) {
+				/* Find the first different item in the first different block */
+				if(mismatched == 0) {
+					double vertex[3];
+					first_item = block * VERIFY_BLOCK_ITEMS;
+					while(first_item < layer->nitems &&
+							memcmp(source_item(ctx, i, first_item, vertex),
+									layer->data + first_item*layer->item_size,
+									layer->item_size) == 0) {
+						first_item++;
+					}
+				}
+				mismatched++;
+			}
+		}
+
+		free(job.source_sums);
+		free(job.received_sums);
+
+		printf("verify: %s: received: %lu/%lu, unexpected: %lu, mismatched blocks: %lu/%lu",
+				layer->name,
+				(unsigned long)layer->nreceived, (unsigned long)layer->nitems,
+				(unsigned long)layer->nunexpected,
+				(unsigned long)mismatched, (unsigned long)nblocks);
+		if(mismatched > 0) {
+			printf(", first mismatched item: %lu", (unsigned long)first_item);
+		}
+		printf("\n");
+
+		if(mismatched > 0 || layer->nreceived != layer->nitems || layer->nunexpected > 0) {
+			ret = 0;
+		}
+	}
+
+	if(ret == 1) {
+		printf("verify: mesh stored at server matches uploaded mesh\n");
+	} else {
+		printf("ERROR: Mesh stored at server does not match uploaded mesh\n");
+	}
+
+	return ret;
+}
+
+/**
+ * @brief This function frees buffers of received items
+ */
+void verify_destroy(struct Verifier *verifier)
+{
+	int i;
+
+	if(verifier == NULL) return;
+
+	for(i = 0; i < verifier->nlayers; i++) {
+		free(verifier->layers[i].data);
+		free(verifier->layers[i].received);
+	}
+	free(verifier);
+}
@@ -0,0 +1,97 @@
+/*
+ *
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ * Contributor(s): Jiri Hnidek <jiri.hnidek@tul.cz>.
+ *
+ */
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ply_props.h"
+
+#ifndef VERIFY_H_
+#define VERIFY_H_
+
+/* Number of items covered by one checksum */
+#define VERIFY_BLOCK_ITEMS 4096
+
+/* Maximal number of verified layers: vertices, faces and properties */
+#define VERIFY_MAX_LAYERS (2 + MAX_PROP_LAYERS)
+
+struct CTX;
+
+/**
+ * Items of one layer received back from server. Buffers are allocated
+ * for all items before upload, so storing of item is only copy.
+ */
+typedef struct VerifyLayer {
+	/* Name of layer used in report */
+	const char *name;
+	/* ID of layer in context (it is known, when layer is created) */
+	const int64_t *layer_id;
+	/* Data type and count of values of items sent to server */
+	uint8_t data_type;
+	uint8_t count;
+	size_t item_size;
+	uint64_t nitems;
+	/* Received items */
+	unsigned char *data;
+	/* Bitmap of received items */
+	uint64_t *received;
+	uint64_t nreceived;
+	/* Number of items with unknown ID, data type or count */
+	uint64_t nunexpected;
+} VerifyLayer;
+
+/**
+ * Verification of mesh stored at server
+ */
+typedef struct Verifier {
+	int nlayers;
+	struct VerifyLayer layers[VERIFY_MAX_LAYERS];
+	/* Flag of finished verification */
+	int done;
+	/* Time without received items, when verification is finished (seconds) */
+	double idle_timeout;
+	/* Number of acknowledged items and time (ns), when it was checked last time */
+	uint64_t last_acked;
+	uint64_t last_time;
+} Verifier;
+
+struct Verifier *verify_create(struct CTX *ctx);
+
+void verify_store(struct Verifier *verifier,
+		const uint16_t layer_id,
+		const uint32_t item_id,
+		const uint8_t data_type,
+		const uint8_t count,
+		const void *value);
+
+void verify_start(struct Verifier *verifier);
+
+int verify_idle(struct Verifier *verifier, uint64_t acked);
+
+int verify_run(struct Verifier *verifier, struct CTX *ctx);
+
+void verify_destroy(struct Verifier *verifier);
+
+#endif /* VERIFY_H_ */